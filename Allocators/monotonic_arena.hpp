@@ -0,0 +1,200 @@
+/**
+ * @file monotonic_arena.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+// Bump allocator for memory that dies all at once, e.g. everything built
+// while serving one request. Allocation moves a pointer through the current
+// chunk and takes a new chunk from `upstream` twice as large as the last one
+// when it runs out; deallocation does nothing. release() gives all chunks
+// back together, so the cost of freeing is the number of chunks, which grows
+// logarithmically with the bytes used, not the number of allocations;
+// reset() also keeps the largest chunk for the next round.
+//
+// The arena is a std::pmr::memory_resource, so it can back
+// std::pmr::polymorphic_allocator, and ArenaAllocator below reaches it
+// without virtual calls. Objects placed in the arena are not destroyed by
+// release(): containers and pointers using it have to be gone before that,
+// or hold only trivially destructible values.
+class MonotonicArena final : public std::pmr::memory_resource {
+ private:
+  struct Chunk {
+    Chunk* next;
+    size_t bytes;
+  };
+
+  static constexpr size_t kMinChunk = 1024;
+
+  std::pmr::memory_resource* upstream_;
+  Chunk* chunks_ = nullptr;
+  char* initial_buffer_ = nullptr;
+  size_t initial_bytes_ = 0;
+  size_t first_chunk_;
+  size_t next_chunk_;
+  char* current_ = nullptr;
+  char* end_ = nullptr;
+  size_t bytes_used_ = 0;
+
+  void* bump(size_t bytes, size_t align) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(current_);
+    uintptr_t aligned = (address + align - 1) & ~uintptr_t(align - 1);
+    if (current_ == nullptr ||
+        aligned + bytes > reinterpret_cast<uintptr_t>(end_)) {
+      return grow(bytes, align);
+    }
+    current_ = reinterpret_cast<char*>(aligned + bytes);
+    return reinterpret_cast<void*>(aligned);
+  }
+
+  void* grow(size_t bytes, size_t align) {
+    size_t needed = sizeof(Chunk) + bytes + align;
+    size_t chunk_bytes = next_chunk_;
+    while (chunk_bytes < needed) {
+      chunk_bytes *= 2;
+    }
+    Chunk* chunk = static_cast<Chunk*>(
+        upstream_->allocate(chunk_bytes, alignof(std::max_align_t)));
+    chunk->next = chunks_;
+    chunk->bytes = chunk_bytes;
+    chunks_ = chunk;
+    next_chunk_ = chunk_bytes * 2;
+    current_ = reinterpret_cast<char*>(chunk + 1);
+    end_ = reinterpret_cast<char*>(chunk) + chunk_bytes;
+    return bump(bytes, align);
+  }
+
+ protected:
+  void* do_allocate(size_t bytes, size_t align) override {
+    return allocate_bytes(bytes, align);
+  }
+
+  void do_deallocate(void*, size_t, size_t) override {}
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+ public:
+  explicit MonotonicArena(
+      size_t first_chunk = 4096,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : upstream_(upstream),
+        first_chunk_(first_chunk < kMinChunk ? kMinChunk : first_chunk),
+        next_chunk_(first_chunk_) {}
+
+  // Serves allocations from `buffer` first, e.g. an array on the stack, and
+  // goes to `upstream` only once it is full.
+  MonotonicArena(
+      void* buffer, size_t bytes,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : MonotonicArena(bytes, upstream) {
+    initial_buffer_ = static_cast<char*>(buffer);
+    initial_bytes_ = bytes;
+    current_ = initial_buffer_;
+    end_ = initial_buffer_ + bytes;
+  }
+
+  MonotonicArena(const MonotonicArena&) = delete;
+  MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+  ~MonotonicArena() override { release(); }
+
+  // Returns `bytes` aligned to `align`, a power of two. Inline so that
+  // ArenaAllocator compiles down to a compare and an add.
+  void* allocate_bytes(size_t bytes,
+                       size_t align = alignof(std::max_align_t)) {
+    bytes_used_ += bytes;
+    return bump(bytes, align);
+  }
+
+  // Gives every chunk back to upstream and starts over from the initial
+  // buffer, if there is one.
+  void release() {
+    while (chunks_) {
+      Chunk* chunk = chunks_;
+      chunks_ = chunk->next;
+      upstream_->deallocate(chunk, chunk->bytes, alignof(std::max_align_t));
+    }
+    current_ = initial_buffer_;
+    end_ = initial_buffer_ + initial_bytes_;
+    next_chunk_ = first_chunk_;
+    bytes_used_ = 0;
+  }
+
+  // Like release(), but keeps the last and largest chunk and starts over
+  // from it, so that an arena reused for request after request stops
+  // calling upstream once it has grown to the size of a request.
+  void reset() {
+    if (chunks_ == nullptr) {
+      release();
+      return;
+    }
+    Chunk* kept = chunks_;
+    chunks_ = kept->next;
+    release();
+    kept->next = nullptr;
+    chunks_ = kept;
+    next_chunk_ = kept->bytes * 2;
+    current_ = reinterpret_cast<char*>(kept + 1);
+    end_ = reinterpret_cast<char*>(kept) + kept->bytes;
+  }
+
+  // Bytes handed out since the last release() or reset(), without alignment
+  // padding.
+  size_t bytes_used() const { return bytes_used_; }
+
+  std::pmr::memory_resource* upstream() const { return upstream_; }
+};
+
+// Allocator over a MonotonicArena for Deque, List and AllocateShared.
+// deallocate() is empty and inline, so freeing an element costs nothing.
+//
+// Like std::pmr::polymorphic_allocator, it stays with the container: it is
+// not propagated on assignment or swap, so a container never ends up
+// holding memory of an arena it was not built in. Assigning between
+// containers of different arenas copies or moves the elements.
+template <typename T>
+class ArenaAllocator {
+ private:
+  MonotonicArena* arena_;
+
+  template <typename U> friend class ArenaAllocator;
+
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::false_type;
+  using propagate_on_container_swap = std::false_type;
+  using is_always_equal = std::false_type;
+
+  ArenaAllocator(MonotonicArena& arena) : arena_(&arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(arena_->allocate_bytes(count * sizeof(T),
+                                                  alignof(T)));
+  }
+
+  void deallocate(T*, size_t) {}
+
+  MonotonicArena& arena() const { return *arena_; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena_;
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return !(*this == other);
+  }
+};
@@ -0,0 +1,161 @@
+/**
+ * @file tracking_allocator.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+
+#include "../SmartPointers/sm_pointers.hpp"
+
+// Counters of one TrackingAllocator and all its copies and rebinds. Every
+// counter is atomic, so the stats may be shared by containers used from
+// different threads.
+class AllocationStats {
+ public:
+  // Bucket i counts requests of [2^(i-1), 2^i) bytes; bucket 0 is empty
+  // requests.
+  static constexpr size_t kBuckets = 8 * sizeof(size_t) + 1;
+
+ private:
+  std::atomic<size_t> deallocations_{0};
+  std::atomic<size_t> bytes_allocated_{0};
+  std::atomic<size_t> bytes_in_use_{0};
+  std::atomic<size_t> peak_bytes_{0};
+  std::atomic<size_t> histogram_[kBuckets] = {};
+
+  static size_t bucket(size_t bytes) {
+    size_t index = 0;
+    while (bytes) {
+      bytes >>= 1;
+      ++index;
+    }
+    return index;
+  }
+
+ public:
+  void on_allocate(size_t bytes) {
+    bytes_allocated_.fetch_add(bytes, std::memory_order_relaxed);
+    histogram_[bucket(bytes)].fetch_add(1, std::memory_order_relaxed);
+    size_t in_use =
+        bytes_in_use_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = peak_bytes_.load(std::memory_order_relaxed);
+    while (in_use > peak &&
+           !peak_bytes_.compare_exchange_weak(peak, in_use,
+                                              std::memory_order_relaxed)) {
+    }
+  }
+
+  void on_deallocate(size_t bytes) {
+    deallocations_.fetch_add(1, std::memory_order_relaxed);
+    bytes_in_use_.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  // Every allocation lands in exactly one bucket, so the histogram doubles
+  // as the allocation count.
+  size_t allocations() const {
+    size_t total = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+      total += histogram(i);
+    }
+    return total;
+  }
+  size_t deallocations() const {
+    return deallocations_.load(std::memory_order_relaxed);
+  }
+  size_t bytes_allocated() const {
+    return bytes_allocated_.load(std::memory_order_relaxed);
+  }
+  size_t bytes_in_use() const {
+    return bytes_in_use_.load(std::memory_order_relaxed);
+  }
+  size_t peak_bytes() const {
+    return peak_bytes_.load(std::memory_order_relaxed);
+  }
+  size_t histogram(size_t index) const {
+    return histogram_[index].load(std::memory_order_relaxed);
+  }
+
+  void print(std::ostream& out) const {
+    out << "allocations " << allocations() << ", deallocations "
+        << deallocations() << ", bytes allocated " << bytes_allocated()
+        << ", in use " << bytes_in_use() << ", peak " << peak_bytes()
+        << '\n';
+    for (size_t i = 0; i < kBuckets; ++i) {
+      if (size_t count = histogram(i)) {
+        size_t low = i == 0 ? 0 : size_t(1) << (i - 1);
+        out << "  " << low << ".." << (low == 0 ? 0 : 2 * low - 1)
+            << " bytes: " << count << '\n';
+      }
+    }
+  }
+};
+
+// Allocator adapter that counts what goes through Upstream into a shared
+// AllocationStats. Rebinding keeps the same stats and rebinds Upstream, so
+// a List's nodes, a Deque's buckets and AllocateShared's blocks are all
+// counted against the stats the container or pointer was given.
+//
+// The allocator travels with the container on copy and move assignment and
+// swap, so the stats keep following the memory they describe.
+template <typename T, typename Upstream = std::allocator<T>>
+class TrackingAllocator {
+ private:
+  using upstream_traits = std::allocator_traits<Upstream>;
+
+  SharedPtr<AllocationStats> stats_;
+  Upstream upstream_;
+
+  template <typename U, typename V> friend class TrackingAllocator;
+
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::false_type;
+
+  template <typename U>
+  struct rebind {
+    using other = TrackingAllocator<
+        U, typename upstream_traits::template rebind_alloc<U>>;
+  };
+
+  // Starts a new set of stats.
+  TrackingAllocator(const Upstream& upstream = Upstream())
+      : stats_(MakeShared<AllocationStats>()), upstream_(upstream) {}
+
+  TrackingAllocator(SharedPtr<AllocationStats> stats,
+                    const Upstream& upstream = Upstream())
+      : stats_(std::move(stats)), upstream_(upstream) {}
+
+  template <typename U, typename V>
+  TrackingAllocator(const TrackingAllocator<U, V>& other)
+      : stats_(other.stats_), upstream_(other.upstream_) {}
+
+  T* allocate(size_t count) {
+    T* ptr = upstream_traits::allocate(upstream_, count);
+    stats_->on_allocate(count * sizeof(T));
+    return ptr;
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    stats_->on_deallocate(count * sizeof(T));
+    upstream_traits::deallocate(upstream_, ptr, count);
+  }
+
+  const SharedPtr<AllocationStats>& stats() const { return stats_; }
+  const Upstream& upstream() const { return upstream_; }
+
+  template <typename U, typename V>
+  bool operator==(const TrackingAllocator<U, V>& other) const {
+    return stats_.get() == other.stats_.get() && upstream_ == other.upstream_;
+  }
+  template <typename U, typename V>
+  bool operator!=(const TrackingAllocator<U, V>& other) const {
+    return !(*this == other);
+  }
+};
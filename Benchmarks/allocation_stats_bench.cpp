@@ -0,0 +1,64 @@
+/**
+ * @file allocation_stats_bench.cpp
+ * @author SofiHaku
+ *
+ * Allocations per operation and bytes in use of Deque, List and
+ * AllocateShared seen through TrackingAllocator, and the time the adapter
+ * adds over the plain std::allocator.
+ * Usage: allocation_stats_bench [elements]
+ */
+
+#include <iostream>
+
+#include "../Allocators/tracking_allocator.hpp"
+#include "../Deque/deque.hpp"
+#include "../List/list.hpp"
+#include "bench_common.hpp"
+
+template <typename Container>
+double Fill(Container& container, size_t elements) {
+  auto start = bench::Clock::now();
+  for (size_t i = 0; i < elements; ++i) {
+    container.push_back(i);
+  }
+  return bench::SecondsSince(start);
+}
+
+template <template <typename, typename> class Container>
+void Compare(const char* name, size_t elements) {
+  Container<size_t, std::allocator<size_t>> plain;
+  double plain_seconds = Fill(plain, elements);
+
+  auto stats = MakeShared<AllocationStats>();
+  Container<size_t, TrackingAllocator<size_t>> tracked{
+      TrackingAllocator<size_t>(stats)};
+  double tracked_seconds = Fill(tracked, elements);
+
+  bench::Report(std::string(name) + "::push_back", 1, elements,
+                plain_seconds);
+  bench::Report(std::string(name) + "::push_back, tracked", 1, elements,
+                tracked_seconds);
+  std::printf("  allocations per push_back: %.3f, peak bytes: %zu\n",
+              static_cast<double>(stats->allocations()) /
+                  static_cast<double>(elements),
+              stats->peak_bytes());
+}
+
+int main(int argc, char** argv) {
+  size_t elements = bench::ArgOr(argc, argv, 1, 1000000);
+  Compare<Deque>("Deque", elements);
+  Compare<List>("List", elements);
+
+  auto stats = MakeShared<AllocationStats>();
+  TrackingAllocator<size_t> alloc(stats);
+  std::vector<SharedPtr<size_t>> pointers;
+  pointers.reserve(elements);
+  for (size_t i = 0; i < elements; ++i) {
+    pointers.push_back(AllocateShared<size_t>(alloc, i));
+  }
+  std::printf("AllocateShared: allocations per pointer: %.3f\n",
+              static_cast<double>(stats->allocations()) /
+                  static_cast<double>(elements));
+  stats->print(std::cout);
+  return 0;
+}
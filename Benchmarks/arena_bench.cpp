@@ -0,0 +1,76 @@
+/**
+ * @file arena_bench.cpp
+ * @author SofiHaku
+ *
+ * One "request" builds a Deque, a List and a batch of AllocateShared
+ * pointers and then throws everything away. Compares std::allocator with
+ * a MonotonicArena reached through ArenaAllocator and through
+ * std::pmr::polymorphic_allocator, which is reset once per request.
+ * Usage: arena_bench [elements] [requests]
+ */
+
+#include <memory_resource>
+#include <vector>
+
+#include "../Allocators/monotonic_arena.hpp"
+#include "../Deque/deque.hpp"
+#include "../List/list.hpp"
+#include "../SmartPointers/sm_pointers.hpp"
+#include "bench_common.hpp"
+
+template <typename Alloc>
+void Request(const Alloc& alloc, size_t elements) {
+  Deque<size_t, Alloc> deque(alloc);
+  List<size_t, Alloc> list(alloc);
+  std::vector<SharedPtr<size_t>> pointers;
+  pointers.reserve(elements);
+  for (size_t i = 0; i < elements; ++i) {
+    deque.push_back(i);
+    list.push_back(i);
+    pointers.push_back(AllocateShared<size_t>(alloc, i));
+  }
+  bench::DoNotOptimize(deque[elements / 2]);
+  bench::DoNotOptimize(*pointers.back());
+}
+
+// Runs `requests` requests, each with the allocator make() returns and
+// followed by end(), and reports the time per request and the share of it
+// spent on the teardown.
+template <typename Make, typename End>
+void Run(const char* name, size_t elements, size_t requests, Make make,
+         End end) {
+  double teardown = 0;
+  auto start = bench::Clock::now();
+  for (size_t i = 0; i < requests; ++i) {
+    Request(make(), elements);
+    auto end_start = bench::Clock::now();
+    end();
+    teardown += bench::SecondsSince(end_start);
+  }
+  double seconds = bench::SecondsSince(start);
+  bench::Report(name, 1, requests, seconds);
+  std::printf("  release: %.0f ns per request\n",
+              teardown * 1e9 / static_cast<double>(requests));
+}
+
+int main(int argc, char** argv) {
+  size_t elements = bench::ArgOr(argc, argv, 1, 1000);
+  size_t requests = bench::ArgOr(argc, argv, 2, 2000);
+
+  Run("std::allocator", elements, requests,
+      [] { return std::allocator<size_t>(); }, [] {});
+
+  MonotonicArena arena;
+  Run("ArenaAllocator", elements, requests,
+      [&] { return ArenaAllocator<size_t>(arena); }, [&] { arena.reset(); });
+
+  Run("pmr::polymorphic_allocator, arena", elements, requests,
+      [&] { return std::pmr::polymorphic_allocator<size_t>(&arena); },
+      [&] { arena.reset(); });
+
+  std::pmr::monotonic_buffer_resource buffer;
+  Run("pmr::monotonic_buffer_resource", elements, requests,
+      [&] { return std::pmr::polymorphic_allocator<size_t>(&buffer); },
+      [&] { buffer.release(); });
+  return 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file atomic_shared_ptr_bench.cpp
+ * @author SofiHaku
+ *
+ * Read-side throughput of a hot-swapped pointer for 1..N reader threads:
+ * AtomicSharedPtr::load (a new SharedPtr per read) and AtomicSharedPtr::read
+ * (a Guard, no count touched) against a SharedPtr guarded by a reader/writer
+ * lock. One extra writer thread republishes the value every 100us.
+ * Usage: atomic_shared_ptr_bench [max threads] [reads per thread]
+ */
+
+#include <mutex>
+#include <shared_mutex>
+
+#include "../SmartPointers/atomic_sm_pointers.hpp"
+#include "bench_common.hpp"
+
+struct Config {
+  size_t version;
+  char payload[120];
+};
+
+template <typename Slot>
+double RunReaders(Slot& slot, size_t threads, size_t reads) {
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    size_t version = 0;
+    while (!done.load(std::memory_order_relaxed)) {
+      slot.publish(MakeShared<Config>(Config{++version, {}}));
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+  double seconds = bench::RunThreads(threads, [&](size_t) {
+    size_t sum = 0;
+    for (size_t i = 0; i < reads; ++i) {
+      sum += slot.read()->version;
+    }
+    bench::DoNotOptimize(sum);
+  });
+  done.store(true);
+  writer.join();
+  return seconds;
+}
+
+struct AtomicSlot {
+  AtomicSharedPtr<Config> ptr{MakeShared<Config>(Config{0, {}})};
+  SharedPtr<Config> read() { return ptr.load(); }
+  void publish(SharedPtr<Config> value) { ptr.store(std::move(value)); }
+};
+
+struct GuardSlot {
+  AtomicSharedPtr<Config> ptr{MakeShared<Config>(Config{0, {}})};
+  AtomicSharedPtr<Config>::Guard read() { return ptr.read(); }
+  void publish(SharedPtr<Config> value) { ptr.store(std::move(value)); }
+};
+
+struct LockedSlot {
+  std::shared_mutex mutex;
+  SharedPtr<Config> ptr = MakeShared<Config>(Config{0, {}});
+  SharedPtr<Config> read() {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return ptr;
+  }
+  void publish(SharedPtr<Config> value) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    ptr = std::move(value);
+  }
+};
+
+int main(int argc, char** argv) {
+  size_t max_threads =
+      bench::ArgOr(argc, argv, 1, std::thread::hardware_concurrency());
+  size_t reads = bench::ArgOr(argc, argv, 2, 2000000);
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    AtomicSlot atomic_slot;
+    bench::Report("AtomicSharedPtr::load", threads, threads * reads,
+                  RunReaders(atomic_slot, threads, reads));
+    GuardSlot guard_slot;
+    bench::Report("AtomicSharedPtr::read", threads, threads * reads,
+                  RunReaders(guard_slot, threads, reads));
+    LockedSlot locked_slot;
+    bench::Report("shared_mutex + SharedPtr", threads, threads * reads,
+                  RunReaders(locked_slot, threads, reads));
+  }
+  return 0;
+}
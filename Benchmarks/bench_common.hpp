@@ -0,0 +1,79 @@
+/**
+ * @file bench_common.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench {
+using Clock = std::chrono::steady_clock;
+
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline size_t ArgOr(int argc, char** argv, int index, size_t fallback) {
+  if (argc > index) {
+    return std::strtoull(argv[index], nullptr, 10);
+  }
+  return fallback;
+}
+
+inline double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Runs body(thread_index) on `threads` threads released together and returns
+// the wall time until the last one finishes.
+template <typename Body>
+double RunThreads(size_t threads, Body body) {
+  std::atomic<size_t> ready{0};
+  std::atomic<bool> go{false};
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; ++i) {
+    workers.emplace_back([&, i] {
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      body(i);
+    });
+  }
+  while (ready.load() != threads) {
+    std::this_thread::yield();
+  }
+  auto start = Clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return SecondsSince(start);
+}
+
+// Prints percentiles of per-operation latencies given in nanoseconds.
+inline void ReportLatency(const std::string& name,
+                          std::vector<double> nanos) {
+  std::sort(nanos.begin(), nanos.end());
+  auto at = [&](double quantile) {
+    return nanos[static_cast<size_t>(quantile * (nanos.size() - 1))];
+  };
+  std::printf("%-40s p50=%10.0f p99=%10.0f p99.9=%10.0f max=%10.0f ns\n",
+              name.c_str(), at(0.5), at(0.99), at(0.999), nanos.back());
+}
+
+inline void Report(const std::string& name, size_t threads, size_t ops,
+                   double seconds) {
+  std::printf("%-40s threads=%-3zu %10.2f ns/op %12.0f ops/s\n", name.c_str(),
+              threads, seconds * 1e9 / static_cast<double>(ops),
+              static_cast<double>(ops) / seconds);
+}
+}  // namespace bench
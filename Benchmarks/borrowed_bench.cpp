@@ -0,0 +1,110 @@
+/**
+ * @file borrowed_bench.cpp
+ * @author SofiHaku
+ *
+ * Reference count traffic and time of passing a pointer down an 8-deep call
+ * chain by SharedPtr value, by const SharedPtr& and by Borrowed, with every
+ * 16th leaf keeping the object. Counts come from a policy that wraps
+ * AtomicCount and tallies its operations. Build with -DNDEBUG: debug builds
+ * of Borrowed hold weak references on purpose.
+ * Usage: borrowed_bench [calls]
+ */
+
+#include "../SmartPointers/sm_pointers.hpp"
+#include "bench_common.hpp"
+
+struct Counting : control_block::AtomicCount {
+  static size_t& operations() {
+    static size_t count = 0;
+    return count;
+  }
+
+  static void increment(count_type& count) {
+    ++operations();
+    AtomicCount::increment(count);
+  }
+  static size_t decrement(count_type& count) {
+    ++operations();
+    return AtomicCount::decrement(count);
+  }
+};
+
+struct Request {
+  size_t id;
+};
+
+using Pointer = SharedPtr<Request, Counting>;
+using View = Borrowed<Request, Counting>;
+
+static constexpr size_t kDepth = 8;
+
+Pointer kept;
+
+template <size_t Depth>
+__attribute__((noinline)) size_t ByValue(Pointer request, size_t call) {
+  if constexpr (Depth == 0) {
+    if (call % 16 == 0) {
+      kept = request;
+    }
+    return request->id;
+  } else {
+    return ByValue<Depth - 1>(request, call) + 1;
+  }
+}
+
+template <size_t Depth>
+__attribute__((noinline)) size_t ByReference(const Pointer& request,
+                                             size_t call) {
+  if constexpr (Depth == 0) {
+    if (call % 16 == 0) {
+      kept = request;
+    }
+    return request->id;
+  } else {
+    return ByReference<Depth - 1>(request, call) + 1;
+  }
+}
+
+template <size_t Depth>
+__attribute__((noinline)) size_t ByBorrowed(View request, size_t call) {
+  if constexpr (Depth == 0) {
+    if (call % 16 == 0) {
+      kept = request.retain();
+    }
+    return request->id;
+  } else {
+    return ByBorrowed<Depth - 1>(request, call) + 1;
+  }
+}
+
+template <typename Chain>
+void Run(const char* name, size_t calls, Chain chain) {
+  auto request = MakeShared<Request, Counting>(Request{7});
+  Counting::operations() = 0;
+  size_t sum = 0;
+  auto start = bench::Clock::now();
+  for (size_t call = 0; call < calls; ++call) {
+    sum += chain(request, call);
+  }
+  double seconds = bench::SecondsSince(start);
+  bench::DoNotOptimize(sum);
+  kept.reset();
+  bench::Report(name, 1, calls, seconds);
+  std::printf("  count operations per call: %.2f\n",
+              static_cast<double>(Counting::operations()) /
+                  static_cast<double>(calls));
+}
+
+int main(int argc, char** argv) {
+  size_t calls = bench::ArgOr(argc, argv, 1, 10000000);
+  Run("SharedPtr by value", calls, [](const Pointer& request, size_t call) {
+    return ByValue<kDepth>(request, call);
+  });
+  Run("const SharedPtr&", calls, [](const Pointer& request, size_t call) {
+    return ByReference<kDepth>(request, call);
+  });
+  Run("Borrowed", calls, [](const Pointer& request, size_t call) {
+    return ByBorrowed<kDepth>(request, call);
+  });
+  return 0;
+}
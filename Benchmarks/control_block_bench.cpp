@@ -0,0 +1,57 @@
+/**
+ * @file control_block_bench.cpp
+ * @author SofiHaku
+ *
+ * Control block sizes and the cost of releasing the last reference.
+ * Usage: control_block_bench [objects]
+ */
+
+#include "../SmartPointers/sm_pointers.hpp"
+#include "bench_common.hpp"
+
+using control_block::AtomicCount;
+using control_block::NonAtomicCount;
+using control_block::WeakLess;
+
+template <typename Block>
+void PrintSize(const char* name) {
+  std::printf("%-48s %3zu bytes\n", name, sizeof(Block));
+}
+
+template <typename Policy, typename Create>
+void ReleaseLast(const char* name, size_t objects, Create create) {
+  std::vector<SharedPtr<int, Policy>> pointers;
+  pointers.reserve(objects);
+  for (size_t i = 0; i < objects; ++i) {
+    pointers.push_back(create());
+  }
+  auto start = bench::Clock::now();
+  pointers.clear();
+  bench::Report(name, 1, objects, bench::SecondsSince(start));
+}
+
+int main(int argc, char** argv) {
+  size_t objects = bench::ArgOr(argc, argv, 1, 5000000);
+
+  using WeakLessMake =
+      control_block::Make<int, std::allocator<int>, WeakLess<AtomicCount>>;
+  using WeakLessBase =
+      control_block::Base<int, std::default_delete<int>, std::allocator<int>,
+                          WeakLess<AtomicCount>>;
+  PrintSize<control_block::Make<int>>("Make<int>");
+  PrintSize<WeakLessMake>("Make<int>, weak-less");
+  PrintSize<control_block::Base<int>>("Base<int>");
+  PrintSize<WeakLessBase>("Base<int>, weak-less");
+
+  ReleaseLast<AtomicCount>("release MakeShared<int>", objects,
+                           [] { return MakeShared<int>(1); });
+  ReleaseLast<WeakLess<AtomicCount>>(
+      "release MakeShared<int>, weak-less", objects,
+      [] { return MakeShared<int, WeakLess<AtomicCount>>(1); });
+  ReleaseLast<NonAtomicCount>(
+      "release MakeShared<int>, non-atomic", objects,
+      [] { return MakeShared<int, NonAtomicCount>(1); });
+  ReleaseLast<AtomicCount>("release SharedPtr(new int)", objects,
+                           [] { return SharedPtr<int>(new int(1)); });
+  return 0;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file counting_policy_bench.cpp
+ * @author SofiHaku
+ *
+ * Copy/destroy throughput of SharedPtr under the atomic, non-atomic and
+ * biased counting policies, and of the mutex-guarded pointer they replace.
+ * The shared-block cases copy a pointer created on the main thread, so
+ * under the biased policy every worker takes the non-owner path; the
+ * hand-off case creates objects on one thread and releases them on another.
+ * Usage: counting_policy_bench [threads] [iterations per thread]
+ */
+
+#include <mutex>
+
+#include "../SmartPointers/sm_pointers.hpp"
+#include "bench_common.hpp"
+
+template <typename Policy>
+void CopyPrivate(const char* name, size_t threads, size_t iterations) {
+  double seconds = bench::RunThreads(threads, [&](size_t) {
+    auto ptr = MakeShared<int, Policy>(1);
+    for (size_t i = 0; i < iterations; ++i) {
+      SharedPtr<int, Policy> copy(ptr);
+      bench::DoNotOptimize(copy);
+    }
+  });
+  bench::Report(name, threads, threads * iterations, seconds);
+}
+
+template <typename Policy>
+void CopyShared(const char* name, size_t threads, size_t iterations) {
+  auto ptr = MakeShared<int, Policy>(1);
+  double seconds = bench::RunThreads(threads, [&](size_t) {
+    for (size_t i = 0; i < iterations; ++i) {
+      SharedPtr<int, Policy> copy(ptr);
+      bench::DoNotOptimize(copy);
+    }
+  });
+  bench::Report(name, threads, threads * iterations, seconds);
+}
+
+void CopySharedMutex(size_t threads, size_t iterations) {
+  auto ptr = MakeShared<int, control_block::NonAtomicCount>(1);
+  std::mutex mutex;
+  double seconds = bench::RunThreads(threads, [&](size_t) {
+    for (size_t i = 0; i < iterations; ++i) {
+      std::unique_lock<std::mutex> lock(mutex);
+      SharedPtr<int, control_block::NonAtomicCount> copy(ptr);
+      bench::DoNotOptimize(copy);
+      copy.reset();
+    }
+  });
+  bench::Report("non-atomic+mutex/shared block", threads, threads * iterations,
+                seconds);
+}
+
+template <typename Policy>
+void HandOff(const char* name, size_t iterations) {
+  size_t objects = iterations / 10;
+  std::vector<SharedPtr<int, Policy>> batch;
+  batch.reserve(objects);
+  double seconds = bench::RunThreads(1, [&](size_t) {
+    for (size_t i = 0; i < objects; ++i) {
+      batch.push_back(MakeShared<int, Policy>(1));
+      for (size_t copy = 0; copy < 8; ++copy) {
+        SharedPtr<int, Policy> local(batch.back());
+        bench::DoNotOptimize(local);
+      }
+    }
+  });
+  seconds += bench::RunThreads(1, [&](size_t) { batch.clear(); });
+  if constexpr (std::is_same<Policy, control_block::BiasedCount>::value) {
+    auto start = bench::Clock::now();
+    control_block::BiasedCount::drain();
+    seconds += bench::SecondsSince(start);
+  }
+  bench::Report(name, 1, objects, seconds);
+}
+
+int main(int argc, char** argv) {
+  size_t threads =
+      bench::ArgOr(argc, argv, 1, std::thread::hardware_concurrency());
+  size_t iterations = bench::ArgOr(argc, argv, 2, 10000000);
+  if (threads == 0) {
+    threads = 1;
+  }
+  CopyPrivate<control_block::NonAtomicCount>("non-atomic/private block",
+                                             threads, iterations);
+  CopyPrivate<control_block::AtomicCount>("atomic/private block", threads,
+                                          iterations);
+  CopyPrivate<control_block::BiasedCount>("biased/private block", threads,
+                                          iterations);
+  CopyShared<control_block::AtomicCount>("atomic/shared block", threads,
+                                         iterations);
+  CopyShared<control_block::BiasedCount>("biased/shared block", threads,
+                                         iterations);
+  CopySharedMutex(threads, iterations);
+  HandOff<control_block::AtomicCount>("atomic/hand-off", iterations);
+  HandOff<control_block::BiasedCount>("biased/hand-off", iterations);
+  return 0;
+}
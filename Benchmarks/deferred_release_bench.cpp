@@ -0,0 +1,72 @@
+/**
+ * @file deferred_release_bench.cpp
+ * @author SofiHaku
+ *
+ * Latency of dropping the last reference to an object graph on a request
+ * thread: inline destruction under AtomicCount against
+ * Deferred<AtomicCount>, whose graphs are destroyed by a background
+ * Reclaimer. Prints percentiles of the release alone.
+ * Usage: deferred_release_bench [requests] [nodes per graph]
+ */
+
+#include "../SmartPointers/reclaimer.hpp"
+#include "bench_common.hpp"
+
+template <typename Policy>
+struct Node {
+  std::vector<double> values;
+  SharedPtr<Node, Policy> next;
+
+  Node(size_t size) : values(size) {}
+};
+
+template <typename Policy>
+struct Graph {
+  std::vector<SharedPtr<Node<Policy>, Policy>> nodes;
+};
+
+template <typename Policy>
+SharedPtr<Graph<Policy>, Policy> Build(size_t nodes) {
+  auto graph = MakeShared<Graph<Policy>, Policy>();
+  graph->nodes.reserve(nodes);
+  for (size_t i = 0; i < nodes; ++i) {
+    graph->nodes.push_back(MakeShared<Node<Policy>, Policy>(8 + i % 64));
+    if (i % 4 != 0) {
+      graph->nodes.back()->next = graph->nodes[i - 1];
+    }
+  }
+  return graph;
+}
+
+template <typename Policy>
+void Requests(const char* name, size_t requests, size_t nodes) {
+  std::vector<double> nanos;
+  nanos.reserve(requests);
+  for (size_t i = 0; i < requests; ++i) {
+    auto graph = Build<Policy>(nodes);
+    auto start = bench::Clock::now();
+    graph.reset();
+    nanos.push_back(bench::SecondsSince(start) * 1e9);
+  }
+  bench::ReportLatency(name, std::move(nanos));
+}
+
+int main(int argc, char** argv) {
+  size_t requests = bench::ArgOr(argc, argv, 1, 2000);
+  size_t nodes = bench::ArgOr(argc, argv, 2, 10000);
+
+  using Deferred = control_block::Deferred<control_block::AtomicCount>;
+  Requests<control_block::AtomicCount>("release, inline", requests, nodes);
+  {
+    Reclaimer<Deferred> reclaimer;
+    Requests<Deferred>("release, deferred", requests, nodes);
+  }
+  auto start = bench::Clock::now();
+  for (size_t i = 0; i < requests / 10; ++i) {
+    Build<Deferred>(nodes);
+  }
+  size_t destroyed = Deferred::drain();
+  bench::Report("build + drain() in one batch", 1, destroyed,
+                bench::SecondsSince(start));
+  return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file hot_path_bench.cpp
+ * @author SofiHaku
+ *
+ * Hardware counters per operation on the hot paths of Deque (index
+ * translation in operator[], iteration, push_back), List (traversal,
+ * push_back) and SharedPtr (copy, MakeShared, WeakPtr::lock), with
+ * std::deque's operator[] as the reference for index translation. Without
+ * access to the counters only ns/op is printed.
+ * Usage: hot_path_bench [elements]
+ */
+
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "../Deque/deque.hpp"
+#include "../List/list.hpp"
+#include "../SmartPointers/sm_pointers.hpp"
+#include "bench_common.hpp"
+#include "perf_counters.hpp"
+
+template <typename Container>
+void IndexRandomly(const char* name, const Container& container,
+                   const std::vector<size_t>& indices) {
+  size_t sum = 0;
+  {
+    perf::Scope scope(name, indices.size());
+    for (size_t index : indices) {
+      sum += container[index];
+    }
+  }
+  bench::DoNotOptimize(sum);
+}
+
+int main(int argc, char** argv) {
+  size_t elements = bench::ArgOr(argc, argv, 1, 1000000);
+
+  std::mt19937_64 random(42);
+  std::vector<size_t> indices(elements);
+  for (size_t& index : indices) {
+    index = random() % elements;
+  }
+
+  Deque<size_t> deque;
+  {
+    perf::Scope scope("Deque::push_back", elements);
+    for (size_t i = 0; i < elements; ++i) {
+      deque.push_back(i);
+    }
+  }
+  std::deque<size_t> std_deque(elements);
+  for (size_t i = 0; i < elements; ++i) {
+    std_deque[i] = i;
+  }
+  IndexRandomly("Deque::operator[] random", deque, indices);
+  IndexRandomly("std::deque::operator[] random", std_deque, indices);
+
+  size_t sum = 0;
+  {
+    perf::Scope scope("Deque::operator[] in order", elements);
+    for (size_t i = 0; i < elements; ++i) {
+      sum += deque[i];
+    }
+  }
+  {
+    perf::Scope scope("Deque iteration", elements);
+    for (auto it = deque.begin(); it != deque.end(); ++it) {
+      sum += *it;
+    }
+  }
+
+  List<size_t> list;
+  {
+    perf::Scope scope("List::push_back", elements);
+    for (size_t i = 0; i < elements; ++i) {
+      list.push_back(i);
+    }
+  }
+  {
+    perf::Scope scope("List traversal", elements);
+    for (auto it = list.begin(); it != list.end(); ++it) {
+      sum += *it;
+    }
+  }
+  bench::DoNotOptimize(sum);
+
+  auto shared = MakeShared<size_t>(1);
+  {
+    perf::Scope scope("SharedPtr copy and destroy", elements);
+    for (size_t i = 0; i < elements; ++i) {
+      SharedPtr<size_t> copy = shared;
+      bench::DoNotOptimize(copy.get());
+    }
+  }
+  {
+    perf::Scope scope("MakeShared and destroy", elements);
+    for (size_t i = 0; i < elements; ++i) {
+      auto made = MakeShared<size_t>(i);
+      bench::DoNotOptimize(made.get());
+    }
+  }
+  WeakPtr<size_t> weak(shared);
+  {
+    perf::Scope scope("WeakPtr::lock", elements);
+    for (size_t i = 0; i < elements; ++i) {
+      auto locked = weak.lock();
+      bench::DoNotOptimize(locked.get());
+    }
+  }
+
+  perf::Report();
+  return 0;
+}
@@ -0,0 +1,249 @@
+/**
+ * @file perf_counters.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters around named benchmark regions. A Scope reads the
+// counters when it opens and closes and charges the difference, divided by
+// the operations it was told the region performs, to its name; Report()
+// prints the per-operation figures of every name.
+//
+// Counters are opened once per thread with perf_event_open, counting user
+// space of the calling thread only, which perf_event_paranoid up to 2
+// allows. Each counter is opened on its own, so a machine without one of
+// them (e.g. no dTLB event in a VM) still reports the others; when none can
+// be opened (no PMU, seccomp, paranoid 3) the scopes keep only the time.
+//
+// A read is a system call per counter, so scopes belong around loops of
+// many operations, not inside the containers.
+namespace perf {
+enum Counter : unsigned int {
+  kCycles,
+  kInstructions,
+  kL1dMisses,
+  kLlcMisses,
+  kDtlbMisses,
+  kBranchMisses,
+  kCounters
+};
+
+inline const char* CounterName(unsigned int counter) {
+  static const char* names[kCounters] = {"cycles",   "instructions",
+                                         "l1d_miss", "llc_miss",
+                                         "dtlb_miss", "branch_miss"};
+  return names[counter];
+}
+
+struct Reading {
+  std::chrono::steady_clock::time_point time;
+  uint64_t values[kCounters] = {};
+};
+
+class Counters {
+ private:
+  int fds_[kCounters];
+  std::string error_;
+
+#ifdef __linux__
+  static uint64_t CacheMiss(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  }
+
+  int open(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    int fd = static_cast<int>(
+        syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+    if (fd < 0 && error_.empty()) {
+      error_ = std::strerror(errno);
+    }
+    return fd;
+  }
+#endif
+
+  Counters() {
+    for (int& fd : fds_) {
+      fd = -1;
+    }
+#ifdef __linux__
+    fds_[kCycles] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fds_[kInstructions] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fds_[kL1dMisses] =
+        open(PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_L1D));
+    fds_[kLlcMisses] =
+        open(PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_LL));
+    fds_[kDtlbMisses] =
+        open(PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_DTLB));
+    fds_[kBranchMisses] =
+        open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#else
+    error_ = "perf_event_open is Linux only";
+#endif
+  }
+
+ public:
+  Counters(const Counters&) = delete;
+  Counters& operator=(const Counters&) = delete;
+
+  ~Counters() {
+#ifdef __linux__
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+#endif
+  }
+
+  static Counters& instance() {
+    static thread_local Counters counters;
+    return counters;
+  }
+
+  bool available(unsigned int counter) const { return fds_[counter] >= 0; }
+
+  // Why the first counter that failed could not be opened, empty if all
+  // were.
+  const std::string& error() const { return error_; }
+
+  // Counts scaled up for the time the kernel had the counter switched off to
+  // multiplex it with others.
+  Reading read() const {
+    Reading reading;
+#ifdef __linux__
+    for (unsigned int counter = 0; counter < kCounters; ++counter) {
+      uint64_t data[3];
+      if (fds_[counter] >= 0 &&
+          ::read(fds_[counter], data, sizeof(data)) == sizeof(data) &&
+          data[2] != 0) {
+        reading.values[counter] = static_cast<uint64_t>(
+            static_cast<double>(data[0]) * data[1] / data[2]);
+      }
+    }
+#endif
+    reading.time = std::chrono::steady_clock::now();
+    return reading;
+  }
+};
+
+struct Totals {
+  std::string name;
+  uint64_t ops = 0;
+  double seconds = 0;
+  double values[kCounters] = {};
+};
+
+class Registry {
+ private:
+  std::vector<Totals> totals_;
+
+ public:
+  static Registry& instance() {
+    static thread_local Registry registry;
+    return registry;
+  }
+
+  void add(const char* name, uint64_t ops, const Reading& start,
+           const Reading& end) {
+    Totals* totals = nullptr;
+    for (Totals& entry : totals_) {
+      if (entry.name == name) {
+        totals = &entry;
+      }
+    }
+    if (!totals) {
+      totals_.push_back(Totals());
+      totals = &totals_.back();
+      totals->name = name;
+    }
+    totals->ops += ops;
+    totals->seconds +=
+        std::chrono::duration<double>(end.time - start.time).count();
+    for (unsigned int counter = 0; counter < kCounters; ++counter) {
+      totals->values[counter] +=
+          static_cast<double>(end.values[counter] - start.values[counter]);
+    }
+  }
+
+  const std::vector<Totals>& totals() const { return totals_; }
+};
+
+// Charges the time and counters spent while alive to `name`, as `ops`
+// operations.
+class Scope {
+ private:
+  const char* name_;
+  uint64_t ops_;
+  Reading start_;
+
+ public:
+  Scope(const char* name, uint64_t ops)
+      : name_(name), ops_(ops), start_(Counters::instance().read()) {}
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+  ~Scope() {
+    Reading end = Counters::instance().read();
+    Registry::instance().add(name_, ops_, start_, end);
+  }
+};
+
+// Per-operation figures of the calling thread's scopes; counters that could
+// not be opened are printed as "-".
+inline void Report(std::FILE* out = stdout) {
+  const Counters& counters = Counters::instance();
+  if (!counters.error().empty()) {
+    std::fprintf(out, "hardware counters partly or not available (%s)%s\n",
+                 counters.error().c_str(),
+                 counters.available(kCycles) ? "" : ", timing only");
+  }
+  std::fprintf(out, "%-32s %10s %10s", "scope", "ops", "ns/op");
+  for (unsigned int counter = 0; counter < kCounters; ++counter) {
+    std::fprintf(out, " %12s", CounterName(counter));
+  }
+  std::fprintf(out, " %6s\n", "ipc");
+  for (const Totals& totals : Registry::instance().totals()) {
+    double ops = static_cast<double>(totals.ops);
+    std::fprintf(out, "%-32s %10llu %10.2f", totals.name.c_str(),
+                 static_cast<unsigned long long>(totals.ops),
+                 totals.seconds * 1e9 / ops);
+    for (unsigned int counter = 0; counter < kCounters; ++counter) {
+      if (counters.available(counter)) {
+        std::fprintf(out, " %12.3f", totals.values[counter] / ops);
+      } else {
+        std::fprintf(out, " %12s", "-");
+      }
+    }
+    if (counters.available(kCycles) && counters.available(kInstructions) &&
+        totals.values[kCycles] > 0) {
+      std::fprintf(out, " %6.2f\n",
+                   totals.values[kInstructions] / totals.values[kCycles]);
+    } else {
+      std::fprintf(out, " %6s\n", "-");
+    }
+  }
+}
+}  // namespace perf
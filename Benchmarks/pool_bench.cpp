@@ -0,0 +1,84 @@
+/**
+ * @file pool_bench.cpp
+ * @author SofiHaku
+ *
+ * Creation and destruction throughput of short-lived shared objects:
+ * MakeShared (pooled control blocks) against AllocateShared with
+ * std::allocator (plain new/delete), and the lock traffic of the pool.
+ * The cross-thread case releases every object on another thread than the
+ * one that created it.
+ * Usage: pool_bench [threads] [objects per thread] [rounds]
+ */
+
+#include "../SmartPointers/sm_pointers.hpp"
+#include "bench_common.hpp"
+
+struct Payload {
+  size_t id;
+  double values[4];
+};
+
+template <typename Create>
+void Churn(const char* name, size_t threads, size_t objects, size_t rounds,
+           Create create) {
+  double seconds = bench::RunThreads(threads, [&](size_t) {
+    std::vector<SharedPtr<Payload>> live;
+    live.reserve(objects);
+    for (size_t round = 0; round < rounds; ++round) {
+      for (size_t i = 0; i < objects; ++i) {
+        live.push_back(create(i));
+      }
+      live.clear();
+    }
+  });
+  bench::Report(name, threads, threads * objects * rounds, seconds);
+}
+
+template <typename Create>
+void CrossThread(const char* name, size_t threads, size_t objects,
+                 size_t rounds, Create create) {
+  std::vector<std::vector<SharedPtr<Payload>>> slots(threads);
+  double seconds = 0;
+  for (size_t round = 0; round < rounds; ++round) {
+    seconds += bench::RunThreads(threads, [&](size_t index) {
+      slots[index].reserve(objects);
+      for (size_t i = 0; i < objects; ++i) {
+        slots[index].push_back(create(i));
+      }
+    });
+    seconds += bench::RunThreads(threads, [&](size_t index) {
+      slots[(index + 1) % threads].clear();
+    });
+  }
+  bench::Report(name, threads, threads * objects * rounds, seconds);
+}
+
+void PrintPoolStats(const char* stage) {
+  pool::PoolStats stats = pool::Stats();
+  std::printf("  pool after %-30s central locks=%zu contended=%zu chunks=%zu\n",
+              stage, stats.central_locks, stats.contended_locks,
+              stats.chunks);
+}
+
+int main(int argc, char** argv) {
+  size_t threads =
+      bench::ArgOr(argc, argv, 1, std::thread::hardware_concurrency());
+  size_t objects = bench::ArgOr(argc, argv, 2, 10000);
+  size_t rounds = bench::ArgOr(argc, argv, 3, 200);
+
+  auto pooled = [](size_t i) { return MakeShared<Payload>(Payload{i, {}}); };
+  auto plain = [](size_t i) {
+    return AllocateShared<Payload>(std::allocator<Payload>(),
+                                   Payload{i, {}});
+  };
+
+  Churn("MakeShared (pool)", threads, objects, rounds, pooled);
+  PrintPoolStats("same-thread churn");
+  Churn("AllocateShared (new/delete)", threads, objects, rounds, plain);
+  CrossThread("MakeShared (pool), cross-thread", threads, objects, rounds,
+              pooled);
+  PrintPoolStats("cross-thread churn");
+  CrossThread("AllocateShared (new/delete), cross-thread", threads, objects,
+              rounds, plain);
+  return 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file priority_queue_bench.cpp
+ * @author SofiHaku
+ *
+ * PriorityQueue (d-ary heap over Deque) for D = 2, 4 and 8 against
+ * std::priority_queue over std::vector: push and pop throughput, building
+ * from a batch (push_bulk against the range constructor), and the latency
+ * of single pushes, where the vector's reallocations show up as the tail.
+ * PriorityQueue stores a handle next to every key, so std::priority_queue
+ * of (key, id) pairs, the same 16 bytes per entry, is measured as well.
+ * Sizes run from 1M elements up to the given maximum in steps of x10.
+ * Usage: priority_queue_bench [max elements]
+ */
+
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../Deque/priority_queue.hpp"
+#include "bench_common.hpp"
+
+using KeyAndId = std::pair<uint64_t, size_t>;
+
+inline uint64_t Key(uint64_t key) { return key; }
+inline uint64_t Key(const KeyAndId& entry) { return entry.first; }
+
+template <typename Value>
+Value Make(uint64_t key) {
+  return key;
+}
+template <>
+KeyAndId Make<KeyAndId>(uint64_t key) {
+  return {key, key};
+}
+
+template <typename Queue>
+void PushPop(const std::string& name, const std::vector<uint64_t>& keys) {
+  Queue queue;
+  auto start = bench::Clock::now();
+  for (uint64_t key : keys) {
+    queue.push(Make<typename Queue::value_type>(key));
+  }
+  bench::Report(name + "::push", 1, keys.size(), bench::SecondsSince(start));
+  uint64_t sum = 0;
+  start = bench::Clock::now();
+  while (!queue.empty()) {
+    sum += Key(queue.top());
+    queue.pop();
+  }
+  bench::Report(name + "::pop", 1, keys.size(), bench::SecondsSince(start));
+  bench::DoNotOptimize(sum);
+}
+
+template <typename Queue>
+void PushLatency(const std::string& name, const std::vector<uint64_t>& keys) {
+  Queue queue;
+  std::vector<double> nanos;
+  nanos.reserve(keys.size());
+  for (uint64_t key : keys) {
+    auto start = bench::Clock::now();
+    queue.push(key);
+    nanos.push_back(bench::SecondsSince(start) * 1e9);
+  }
+  bench::ReportLatency(name + "::push", std::move(nanos));
+}
+
+template <size_t D>
+void Ours(const std::vector<uint64_t>& keys) {
+  std::string name = "PriorityQueue<D=" + std::to_string(D) + ">";
+  PushPop<PriorityQueue<uint64_t, std::less<uint64_t>, D>>(name, keys);
+  PriorityQueue<uint64_t, std::less<uint64_t>, D> queue;
+  auto start = bench::Clock::now();
+  queue.push_bulk(keys.begin(), keys.end());
+  bench::Report(name + "::push_bulk", 1, keys.size(),
+                bench::SecondsSince(start));
+  bench::DoNotOptimize(queue.top());
+}
+
+int main(int argc, char** argv) {
+  size_t max_elements = bench::ArgOr(argc, argv, 1, 10000000);
+  for (size_t elements = 1000000; elements <= max_elements; elements *= 10) {
+    std::printf("%zu elements\n", elements);
+    std::mt19937_64 random(42);
+    std::vector<uint64_t> keys(elements);
+    for (uint64_t& key : keys) {
+      key = random();
+    }
+
+    PushPop<std::priority_queue<uint64_t>>("std::priority_queue", keys);
+    PushPop<std::priority_queue<KeyAndId>>("std::priority_queue<key, id>",
+                                           keys);
+    {
+      auto start = bench::Clock::now();
+      std::priority_queue<uint64_t> queue(keys.begin(), keys.end());
+      bench::Report("std::priority_queue(first, last)", 1, elements,
+                    bench::SecondsSince(start));
+      bench::DoNotOptimize(queue.top());
+    }
+    Ours<2>(keys);
+    Ours<4>(keys);
+    Ours<8>(keys);
+
+    PushLatency<std::priority_queue<uint64_t>>("std::priority_queue", keys);
+    PushLatency<PriorityQueue<uint64_t>>("PriorityQueue<D=4>", keys);
+  }
+  return 0;
+}
@@ -0,0 +1,357 @@
+/**
+ * @file std_compare_bench.cpp
+ * @author SofiHaku
+ *
+ * Deque, List and SharedPtr against std::deque, std::list and
+ * std::shared_ptr, case by case, for several element and container sizes.
+ * Every case is run `repeats` times and the median is kept; inputs come
+ * from a fixed seed, so two runs differ only by the code under test. The
+ * results are also written as JSON, one object per measurement, to be
+ * diffed between commits.
+ * Usage: std_compare_bench [output.json] [max size] [repeats]
+ */
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Deque/deque.hpp"
+#include "../List/list.hpp"
+#include "../SmartPointers/sm_pointers.hpp"
+#include "bench_common.hpp"
+
+template <size_t kBytes>
+struct Element {
+  std::array<size_t, kBytes / sizeof(size_t)> words{};
+  Element() {}
+  Element(size_t key) { words[0] = key; }
+};
+
+struct Result {
+  std::string component;
+  std::string impl;
+  std::string name;
+  size_t element_bytes;
+  size_t size;
+  double ns_per_op;
+};
+
+class Suite {
+ private:
+  size_t repeats_;
+  std::vector<Result> results_;
+
+ public:
+  explicit Suite(size_t repeats) : repeats_(repeats) {}
+
+  // body() runs the case once and returns the seconds spent on the `ops`
+  // operations it times.
+  template <typename Body>
+  void Run(const char* component, const char* impl, const char* name,
+           size_t element_bytes, size_t size, size_t ops, Body body) {
+    std::vector<double> seconds;
+    for (size_t i = 0; i < repeats_; ++i) {
+      seconds.push_back(body());
+    }
+    std::sort(seconds.begin(), seconds.end());
+    double ns = seconds[seconds.size() / 2] * 1e9 / static_cast<double>(ops);
+    results_.push_back({component, impl, name, element_bytes, size, ns});
+    std::printf("%-10s %-18s %-14s %5zuB n=%-8zu %10.2f ns/op\n", component,
+                impl, name, element_bytes, size, ns);
+  }
+
+  void WriteJson(std::ostream& out) const {
+    out << "{\"repeats\":" << repeats_ << ",\"results\":[\n";
+    for (size_t i = 0; i < results_.size(); ++i) {
+      const Result& result = results_[i];
+      out << "{\"component\":\"" << result.component << "\",\"impl\":\""
+          << result.impl << "\",\"case\":\"" << result.name
+          << "\",\"element_bytes\":" << result.element_bytes
+          << ",\"size\":" << result.size
+          << ",\"ns_per_op\":" << result.ns_per_op << '}'
+          << (i + 1 == results_.size() ? "\n" : ",\n");
+    }
+    out << "]}\n";
+  }
+};
+
+template <typename Container>
+Container Filled(size_t size) {
+  Container container;
+  for (size_t i = 0; i < size; ++i) {
+    container.push_back(typename Container::value_type(i));
+  }
+  return container;
+}
+
+template <typename Container>
+double PushBack(size_t size) {
+  auto start = bench::Clock::now();
+  Container container;
+  for (size_t i = 0; i < size; ++i) {
+    container.push_back(typename Container::value_type(i));
+  }
+  double seconds = bench::SecondsSince(start);
+  bench::DoNotOptimize(container.size());
+  return seconds;
+}
+
+template <typename Container>
+double PushFront(size_t size) {
+  auto start = bench::Clock::now();
+  Container container;
+  for (size_t i = 0; i < size; ++i) {
+    container.push_front(typename Container::value_type(i));
+  }
+  double seconds = bench::SecondsSince(start);
+  bench::DoNotOptimize(container.size());
+  return seconds;
+}
+
+template <typename Container>
+double PopBack(size_t size) {
+  Container container = Filled<Container>(size);
+  auto start = bench::Clock::now();
+  for (size_t i = 0; i < size; ++i) {
+    container.pop_back();
+  }
+  double seconds = bench::SecondsSince(start);
+  bench::DoNotOptimize(container.size());
+  return seconds;
+}
+
+template <typename Container>
+double PopFront(size_t size) {
+  Container container = Filled<Container>(size);
+  auto start = bench::Clock::now();
+  for (size_t i = 0; i < size; ++i) {
+    container.pop_front();
+  }
+  double seconds = bench::SecondsSince(start);
+  bench::DoNotOptimize(container.size());
+  return seconds;
+}
+
+template <typename Container>
+double RandomIndex(size_t size) {
+  Container container = Filled<Container>(size);
+  std::mt19937_64 random(42);
+  std::vector<size_t> indices(size);
+  for (size_t& index : indices) {
+    index = random() % size;
+  }
+  size_t sum = 0;
+  auto start = bench::Clock::now();
+  for (size_t index : indices) {
+    sum += container[index].words[0];
+  }
+  double seconds = bench::SecondsSince(start);
+  bench::DoNotOptimize(sum);
+  return seconds;
+}
+
+template <typename Container>
+double Iterate(size_t size) {
+  Container container = Filled<Container>(size);
+  size_t sum = 0;
+  auto start = bench::Clock::now();
+  for (auto it = container.begin(); it != container.end(); ++it) {
+    sum += (*it).words[0];
+  }
+  double seconds = bench::SecondsSince(start);
+  bench::DoNotOptimize(sum);
+  return seconds;
+}
+
+// `count` inserts and then `count` erases in the middle.
+template <typename Container>
+double InsertErase(size_t size, size_t count) {
+  Container container = Filled<Container>(size);
+  typename Container::value_type value(size);
+  auto start = bench::Clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    container.insert(container.begin() + container.size() / 2, value);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    container.erase(container.begin() + container.size() / 2);
+  }
+  double seconds = bench::SecondsSince(start);
+  bench::DoNotOptimize(container.size());
+  return seconds;
+}
+
+template <typename Container>
+double Copy(size_t size) {
+  Container container = Filled<Container>(size);
+  auto start = bench::Clock::now();
+  Container copy(container);
+  double seconds = bench::SecondsSince(start);
+  bench::DoNotOptimize(copy.size());
+  return seconds;
+}
+
+// `count` round trips, each a move construction and a move assignment.
+template <typename Container>
+double Move(size_t size, size_t count) {
+  Container container = Filled<Container>(size);
+  auto start = bench::Clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    Container other(std::move(container));
+    container = std::move(other);
+  }
+  double seconds = bench::SecondsSince(start);
+  bench::DoNotOptimize(container.size());
+  return seconds;
+}
+
+struct Sm {
+  template <typename T>
+  using Shared = SharedPtr<T>;
+  template <typename T>
+  using Weak = WeakPtr<T>;
+  template <typename T>
+  static Shared<T> Make(size_t key) {
+    return MakeShared<T>(key);
+  }
+};
+
+struct Std {
+  template <typename T>
+  using Shared = std::shared_ptr<T>;
+  template <typename T>
+  using Weak = std::weak_ptr<T>;
+  template <typename T>
+  static Shared<T> Make(size_t key) {
+    return std::make_shared<T>(key);
+  }
+};
+
+template <typename Family, typename T>
+double MakeAndDrop(size_t count) {
+  auto start = bench::Clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    auto ptr = Family::template Make<T>(i);
+    bench::DoNotOptimize(ptr.get());
+  }
+  return bench::SecondsSince(start);
+}
+
+template <typename Family, typename T>
+double CopyAndDrop(size_t count) {
+  auto ptr = Family::template Make<T>(0);
+  auto start = bench::Clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    auto copy = ptr;
+    bench::DoNotOptimize(copy.get());
+  }
+  return bench::SecondsSince(start);
+}
+
+template <typename Family, typename T>
+double Destroy(size_t count) {
+  std::vector<typename Family::template Shared<T>> pointers;
+  pointers.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    pointers.push_back(Family::template Make<T>(i));
+  }
+  auto start = bench::Clock::now();
+  pointers.clear();
+  return bench::SecondsSince(start);
+}
+
+template <typename Family, typename T>
+double Lock(size_t count) {
+  auto ptr = Family::template Make<T>(0);
+  typename Family::template Weak<T> weak(ptr);
+  auto start = bench::Clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    auto locked = weak.lock();
+    bench::DoNotOptimize(locked.get());
+  }
+  return bench::SecondsSince(start);
+}
+
+constexpr size_t kInsertErase = 64;
+constexpr size_t kMoves = 1000;
+
+// List has neither operator[] nor insert/erase, so those cases run only
+// for kRandomAccess containers.
+template <typename Ours, typename Theirs, bool kRandomAccess>
+void CompareSequence(Suite& suite, const char* component, const char* ours,
+                     const char* theirs, size_t bytes, size_t size) {
+  auto both = [&](const char* name, size_t ops, double (*our_case)(size_t),
+                  double (*their_case)(size_t)) {
+    suite.Run(component, ours, name, bytes, size, ops,
+              [&] { return our_case(size); });
+    suite.Run(component, theirs, name, bytes, size, ops,
+              [&] { return their_case(size); });
+  };
+  both("push_back", size, PushBack<Ours>, PushBack<Theirs>);
+  both("push_front", size, PushFront<Ours>, PushFront<Theirs>);
+  both("pop_back", size, PopBack<Ours>, PopBack<Theirs>);
+  both("pop_front", size, PopFront<Ours>, PopFront<Theirs>);
+  both("iterate", size, Iterate<Ours>, Iterate<Theirs>);
+  both("copy", size, Copy<Ours>, Copy<Theirs>);
+  suite.Run(component, ours, "move", bytes, size, 2 * kMoves,
+            [&] { return Move<Ours>(size, kMoves); });
+  suite.Run(component, theirs, "move", bytes, size, 2 * kMoves,
+            [&] { return Move<Theirs>(size, kMoves); });
+  if constexpr (kRandomAccess) {
+    both("operator[]", size, RandomIndex<Ours>, RandomIndex<Theirs>);
+    size_t count = std::min(size, kInsertErase);
+    suite.Run(component, ours, "insert_erase", bytes, size, 2 * count,
+              [&] { return InsertErase<Ours>(size, count); });
+    suite.Run(component, theirs, "insert_erase", bytes, size, 2 * count,
+              [&] { return InsertErase<Theirs>(size, count); });
+  }
+}
+
+template <size_t kBytes>
+void CompareAll(Suite& suite, const std::vector<size_t>& sizes) {
+  using T = Element<kBytes>;
+  for (size_t size : sizes) {
+    CompareSequence<Deque<T>, std::deque<T>, true>(
+        suite, "deque", "Deque", "std::deque", kBytes, size);
+    CompareSequence<List<T>, std::list<T>, false>(suite, "list", "List",
+                                                  "std::list", kBytes, size);
+    auto both = [&](const char* name, double (*our_case)(size_t),
+                    double (*their_case)(size_t)) {
+      suite.Run("shared_ptr", "SharedPtr", name, kBytes, size, size,
+                [&] { return our_case(size); });
+      suite.Run("shared_ptr", "std::shared_ptr", name, kBytes, size, size,
+                [&] { return their_case(size); });
+    };
+    both("make_shared", MakeAndDrop<Sm, T>, MakeAndDrop<Std, T>);
+    both("copy_destroy", CopyAndDrop<Sm, T>, CopyAndDrop<Std, T>);
+    both("destroy", Destroy<Sm, T>, Destroy<Std, T>);
+    both("weak_lock", Lock<Sm, T>, Lock<Std, T>);
+  }
+}
+
+int main(int argc, char** argv) {
+  std::string output = argc > 1 ? argv[1] : "std_compare.json";
+  size_t max_size = bench::ArgOr(argc, argv, 2, 100000);
+  size_t repeats = bench::ArgOr(argc, argv, 3, 5);
+
+  std::vector<size_t> sizes;
+  for (size_t size = 1000; size <= max_size; size *= 10) {
+    sizes.push_back(size);
+  }
+
+  Suite suite(repeats);
+  CompareAll<8>(suite, sizes);
+  CompareAll<64>(suite, sizes);
+  CompareAll<256>(suite, sizes);
+
+  std::ofstream out(output);
+  suite.WriteJson(out);
+  std::printf("results written to %s\n", output.c_str());
+  return 0;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file telemetry_bench.cpp
+ * @author SofiHaku
+ *
+ * Cost of control block telemetry. Build it once as is and once with
+ * -DSM_POINTERS_TELEMETRY: without the define the block sizes and timings
+ * must match a build from before telemetry existed; with it the program
+ * also prints the collected report, as text and as JSON.
+ * Usage: telemetry_bench [iterations]
+ */
+
+#include "../SmartPointers/sm_pointers.hpp"
+#include "bench_common.hpp"
+
+struct Widget {
+  size_t id;
+};
+
+struct Gadget {
+  double values[4];
+};
+
+int main(int argc, char** argv) {
+  size_t iterations = bench::ArgOr(argc, argv, 1, 10000000);
+#ifdef SM_POINTERS_TELEMETRY
+  std::printf("telemetry: compiled in\n");
+#else
+  std::printf("telemetry: compiled out\n");
+#endif
+  std::printf("sizeof(Make<int>) = %zu, sizeof(Base<int>) = %zu\n",
+              sizeof(control_block::Make<int>),
+              sizeof(control_block::Base<int>));
+
+  auto widget = MakeShared<Widget>(Widget{1});
+  auto start = bench::Clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    SharedPtr<Widget> copy(widget);
+    bench::DoNotOptimize(copy);
+  }
+  bench::Report("copy + destroy", 1, iterations, bench::SecondsSince(start));
+
+  WeakPtr<Widget> weak(widget);
+  start = bench::Clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    SharedPtr<Widget> locked = weak.lock();
+    bench::DoNotOptimize(locked);
+  }
+  bench::Report("WeakPtr::lock", 1, iterations, bench::SecondsSince(start));
+
+  start = bench::Clock::now();
+  for (size_t i = 0; i < iterations / 10; ++i) {
+    auto gadget = MakeShared<Gadget>();
+    bench::DoNotOptimize(gadget);
+  }
+  bench::Report("MakeShared + destroy", 1, iterations / 10,
+                bench::SecondsSince(start));
+
+#ifdef SM_POINTERS_TELEMETRY
+  telemetry::Report(std::cout);
+  telemetry::ReportJson(std::cout);
+#endif
+  return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file window_aggregator_bench.cpp
+ * @author SofiHaku
+ *
+ * A stream where every tick brings a batch of events, the oldest ones beyond
+ * the window size expire and the window is queried once. WindowAggregator
+ * against keeping the events in a Deque and folding the whole window on
+ * every tick, for a sum, a max and a log2 histogram read as a p99 latency
+ * sketch, over window sizes and batch sizes. Figures are per event; the
+ * rescan runs fewer events on large windows to keep its time bounded.
+ * Usage: window_aggregator_bench [events]
+ */
+
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Deque/window_aggregator.hpp"
+#include "bench_common.hpp"
+
+// Counts of values by the position of their highest set bit.
+struct Log2Histogram {
+  using Aggregate = std::array<uint32_t, 64>;
+  Aggregate identity() const { return Aggregate{}; }
+  Aggregate lift(uint64_t value) const {
+    Aggregate counts{};
+    ++counts[Bucket(value)];
+    return counts;
+  }
+  Aggregate combine(const Aggregate& left, const Aggregate& right) const {
+    Aggregate sum;
+    for (size_t i = 0; i < sum.size(); ++i) {
+      sum[i] = left[i] + right[i];
+    }
+    return sum;
+  }
+  static size_t Bucket(uint64_t value) {
+    return 63 - static_cast<size_t>(__builtin_clzll(value | 1));
+  }
+};
+
+// What a query hands on: the aggregate itself, or the p99 bucket of a
+// histogram.
+template <typename Aggregate>
+const Aggregate& Read(const Aggregate& aggregate) {
+  return aggregate;
+}
+size_t Read(const Log2Histogram::Aggregate& counts) {
+  uint64_t total = 0;
+  for (uint32_t count : counts) {
+    total += count;
+  }
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    seen += counts[i];
+    if (seen * 100 >= total * 99) {
+      return i;
+    }
+  }
+  return counts.size();
+}
+
+// Adds one event to a fold in progress, the way a rescan would: through the
+// monoid, or by counting it straight into the histogram.
+template <typename Monoid>
+void Accumulate(const Monoid& monoid, typename Monoid::Aggregate& aggregate,
+                uint64_t value) {
+  aggregate = monoid.combine(aggregate, monoid.lift(value));
+}
+void Accumulate(const Log2Histogram&, Log2Histogram::Aggregate& counts,
+                uint64_t value) {
+  ++counts[Log2Histogram::Bucket(value)];
+}
+
+template <typename Monoid>
+void Aggregator(const std::string& name, const std::vector<uint64_t>& values,
+                size_t window, size_t batch) {
+  WindowAggregator<uint64_t, Monoid> aggregator;
+  aggregator.push_back(values.begin(), values.begin() + window);
+  auto start = bench::Clock::now();
+  for (size_t next = window; next + batch <= values.size(); next += batch) {
+    aggregator.push_back(values.begin() + next,
+                         values.begin() + next + batch);
+    aggregator.pop_front(aggregator.size() - window);
+    bench::DoNotOptimize(Read(aggregator.query()));
+  }
+  bench::Report(name, 1, values.size() - window, bench::SecondsSince(start));
+}
+
+template <typename Monoid>
+void Rescan(const std::string& name, const std::vector<uint64_t>& values,
+            size_t window, size_t batch) {
+  Monoid monoid;
+  Deque<uint64_t> events;
+  for (size_t i = 0; i < window; ++i) {
+    events.push_back(values[i]);
+  }
+  // About 10^8 events visited in all.
+  size_t end = window + 100000000 / window * batch;
+  end = end < values.size() ? end : values.size();
+  auto start = bench::Clock::now();
+  for (size_t next = window; next + batch <= end; next += batch) {
+    for (size_t i = next; i < next + batch; ++i) {
+      events.push_back(values[i]);
+    }
+    while (events.size() > window) {
+      events.pop_front();
+    }
+    typename Monoid::Aggregate aggregate = monoid.identity();
+    for (size_t i = 0; i < events.size(); ++i) {
+      Accumulate(monoid, aggregate, events[i]);
+    }
+    bench::DoNotOptimize(Read(aggregate));
+  }
+  bench::Report(name, 1, end - window, bench::SecondsSince(start));
+}
+
+template <typename Monoid>
+void Compare(const char* monoid_name, const std::vector<uint64_t>& values,
+             size_t window, size_t batch) {
+  std::string suffix = std::string("<") + monoid_name +
+                       "> window=" + std::to_string(window) +
+                       " batch=" + std::to_string(batch);
+  Aggregator<Monoid>("WindowAggregator" + suffix, values, window, batch);
+  Rescan<Monoid>("rescan" + suffix, values, window, batch);
+}
+
+int main(int argc, char** argv) {
+  size_t events = bench::ArgOr(argc, argv, 1, 4000000);
+  std::mt19937_64 random(42);
+  std::vector<uint64_t> values(events);
+  for (uint64_t& value : values) {
+    value = random() >> (random() % 48);
+  }
+  for (size_t window : {1000, 10000, 100000}) {
+    if (window >= events) {
+      break;
+    }
+    for (size_t batch : {1, 64}) {
+      Compare<window::Sum<uint64_t>>("sum", values, window, batch);
+      Compare<window::Max<uint64_t>>("max", values, window, batch);
+      Compare<Log2Histogram>("log2 histogram", values, window, batch);
+    }
+  }
+  return 0;
+}
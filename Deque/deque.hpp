@@ -3,19 +3,27 @@
  * @author SofiHaku
  */
 
+#pragma once
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 template <typename T, typename Alloc = std::allocator<T>>
 class Deque {
  private:
-  static const size_t kBucket = 10;
+  // Elements per bucket: 512 bytes' worth, as in libstdc++, but at least 16
+  // so that neighbours of large elements still share a bucket.
+  static const size_t kBucket = 512 / sizeof(T) > 16 ? 512 / sizeof(T) : 16;
   static const size_t kMemory = 3;
   static const size_t kStartNumberBuckets = 2;
   size_t size_ = 0;
-  size_t index_bucket_start_;
+  size_t index_bucket_start_ = 0;
   size_t index_element_start_ = kBucket / 2;
   std::vector<T*> memory_;
   using alloc_traits = std::allocator_traits<Alloc>;
@@ -28,6 +36,49 @@ class Deque {
       ++real_index.first;
     }
   }
+  // Buckets are allocated lazily, so some slots of memory_ stay empty.
+  void release_buckets() {
+    for (size_t i = 0; i < memory_.size(); ++i) {
+      if (memory_[i] != nullptr) {
+        alloc_traits::deallocate(alloc_, memory_[i], kBucket);
+      }
+    }
+    memory_.clear();
+  }
+  void swap_storage(Deque& other) {
+    std::swap(memory_, other.memory_);
+    std::swap(size_, other.size_);
+    std::swap(index_bucket_start_, other.index_bucket_start_);
+    std::swap(index_element_start_, other.index_element_start_);
+  }
+  // Constructs `count` elements, the i-th from get(i), or value-initialised
+  // when no get is given, into fresh buckets.
+  template <typename... Get>
+  void fill(size_t count, Get... get) {
+    std::pair<size_t, size_t> real_index;
+    try {
+      start_allocate(count);
+      for (size_t i = 0; i < size_; ++i) {
+        try {
+          get_real_index(i, real_index);
+          alloc_traits::construct(
+              alloc_, &memory_[real_index.first][real_index.second],
+              get(i)...);
+        } catch (...) {
+          for (size_t j = 0; j < i; ++j) {
+            get_real_index(j, real_index);
+            alloc_traits::destroy(
+                alloc_, &memory_[real_index.first][real_index.second]);
+          }
+          throw;
+        }
+      }
+    } catch (...) {
+      std::cout << "error in constructor" << std::endl;
+      release_buckets();
+      throw;
+    }
+  }
   void start_allocate(size_t count) {
     size_ = count;
     size_t number_used_buckets = size_ / kBucket + kStartNumberBuckets;
@@ -38,14 +89,32 @@ class Deque {
           alloc_traits::allocate(alloc_, kBucket);
     }
   }
+  // Makes room for a bucket past either end of memory_. When the buckets in
+  // use fill at most half of it, they are moved to the middle instead of
+  // growing memory_: the spare buckets left behind by pop_front (or
+  // pop_back) rotate to the other end and are reused, so a deque used as a
+  // queue keeps a bounded number of buckets.
+  void make_room() {
+    size_t used = (index_element_start_ + size_) / kBucket + 2;
+    if (used * 2 <= memory_.size()) {
+      size_t target = (memory_.size() - used) / 2;
+      size_t shift = index_bucket_start_ > target
+                         ? index_bucket_start_ - target
+                         : memory_.size() - (target - index_bucket_start_);
+      std::rotate(memory_.begin(), memory_.begin() + shift, memory_.end());
+      index_bucket_start_ = target;
+      return;
+    }
+    std::vector<T*> new_memory(memory_.size() * kMemory, nullptr);
+    for (size_t i = 0; i < memory_.size(); i++) {
+      new_memory[memory_.size() + i] = memory_[i];
+    }
+    index_bucket_start_ += memory_.size();
+    std::swap(new_memory, memory_);
+  }
   void add_allocate_back(std::pair<size_t, size_t>& real_index) {
     if (real_index.first >= memory_.size()) {
-      std::vector<T*> new_memory(memory_.size() * kMemory, nullptr);
-      for (size_t i = 0; i < memory_.size(); i++) {
-        new_memory[memory_.size() + i] = memory_[i];
-      }
-      index_bucket_start_ += memory_.size();
-      std::swap(new_memory, memory_);
+      make_room();
       get_real_index(size_, real_index);
     }
     if (memory_[real_index.first] == nullptr) {
@@ -54,127 +123,56 @@ class Deque {
   }
   void add_allocate_front() {
     if ((index_bucket_start_ == 0) && (index_element_start_ == 0)) {
-      std::vector<T*> new_memory(memory_.size() * kMemory, nullptr);
-      for (size_t i = 0; i < memory_.size(); i++) {
-        new_memory[memory_.size() + i] = memory_[i];
-      }
-      index_bucket_start_ += memory_.size();
-      std::swap(new_memory, memory_);
+      make_room();
     }
-    if ((index_element_start_ == 0) &&
-        (memory_[index_bucket_start_ - 1] == nullptr)) {
-      memory_[index_bucket_start_ - 1] =
-          alloc_traits::allocate(alloc_, kBucket);
+    if (index_element_start_ == 0) {
+      if (memory_[index_bucket_start_ - 1] == nullptr) {
+        memory_[index_bucket_start_ - 1] =
+            alloc_traits::allocate(alloc_, kBucket);
+      }
       index_bucket_start_--;
       index_element_start_ = kBucket;
     }
     index_element_start_--;
   }
  public:
+  using value_type = T;
   using allocator_type = Alloc;
   Deque(size_t count, const T& value, const Alloc& alloc = Alloc())
       : alloc_(alloc) {
-    try {
-      std::pair<size_t, size_t> real_index;
-      start_allocate(count);
-      for (size_t i = 0; i < size_; ++i) {
-        try {
-          get_real_index(i, real_index);
-          alloc_traits::construct(
-              alloc_, &memory_[real_index.first][real_index.second], value);
-        } catch (...) {
-          for (size_t j = 0; j < i; ++j) {
-            get_real_index(j, real_index);
-            alloc_traits::destroy(
-                alloc_, &memory_[real_index.first][real_index.second]);
-          }
-          throw;
-        }
-      }
-    } catch (...) {
-      std::cout << "error in constructor" << std::endl;
-      for (size_t i = 0; i < memory_.size(); i++) {
-        alloc_traits::deallocate(alloc_, memory_[i], kBucket);
-      }
-      throw;
-    }
+    fill(count, [&](size_t) -> const T& { return value; });
   }
   Deque(const Alloc& alloc = Alloc()) : size_(0), alloc_(alloc) {}
   Deque(size_t count, const Alloc& alloc = Alloc()) : alloc_(alloc) {
-    std::pair<size_t, size_t> real_index;
-    try {
-      start_allocate(count);
-      for (size_t i = 0; i < size_; ++i) {
-        try {
-          get_real_index(i, real_index);
-          alloc_traits::construct(
-              alloc_, &memory_[real_index.first][real_index.second]);
-        } catch (...) {
-          for (size_t j = 0; j < i; ++j) {
-            get_real_index(j, real_index);
-            alloc_traits::destroy(
-                alloc_, &memory_[real_index.first][real_index.second]);
-          }
-          throw;
-        }
-      }
-    } catch (...) {
-      std::cout << "error in constructor" << std::endl;
-      for (size_t i = 0; i < memory_.size(); i++) {
-        alloc_traits::deallocate(alloc_, memory_[i], kBucket);
-      }
-      throw;
-    }
+    fill(count);
   }
   Deque(const Deque& other)
-      : alloc_(
-            alloc_traits::select_on_container_copy_construction(other.alloc_)) {
-    std::pair<size_t, size_t> real_index;
-    try {
-      start_allocate(other.size());
-      for (size_t i = 0; i < size_; ++i) {
-        try {
-          get_real_index(i, real_index);
-          alloc_traits::construct(
-              alloc_, &memory_[real_index.first][real_index.second], other[i]);
-        } catch (...) {
-          for (size_t j = 0; j < i; ++j) {
-            get_real_index(j, real_index);
-            alloc_traits::destroy(
-                alloc_, &memory_[real_index.first][real_index.second]);
-          }
-          throw;
-        }
-      }
-    } catch (...) {
-      std::cout << "error in constructor" << std::endl;
-      for (size_t i = 0; i < memory_.size(); i++) {
-        alloc_traits::deallocate(alloc_, memory_[i], kBucket);
-      }
-      throw;
-    }
+      : Deque(other, alloc_traits::select_on_container_copy_construction(
+                         other.alloc_)) {}
+  Deque(const Deque& other, const Alloc& alloc) : alloc_(alloc) {
+    fill(other.size(), [&](size_t i) -> const T& { return other[i]; });
   }
+  // The buckets move together with the allocator that owns them.
   Deque(Deque&& other)
       : size_(std::exchange(other.size_, 0)),
         index_bucket_start_(std::exchange(other.index_bucket_start_, 0)),
         index_element_start_(std::exchange(other.index_element_start_, 0)),
-        memory_(std::move(other.memory_)) {
-    if (alloc_traits::propagate_on_container_move_assignment::value) {
-      alloc_ = std::move(other.alloc_);
-    } else {
-      alloc_ = Alloc();
+        memory_(std::move(other.memory_)),
+        alloc_(std::move(other.alloc_)) {
+    other.memory_.clear();
+  }
+  // Takes the buckets of `other` if `alloc` can free them, and moves the
+  // elements one by one into buckets of `alloc` otherwise.
+  Deque(Deque&& other, const Alloc& alloc) : alloc_(alloc) {
+    if (alloc_ == other.alloc_) {
+      swap_storage(other);
+      return;
     }
+    fill(other.size(), [&](size_t i) -> T&& { return std::move(other[i]); });
   }
   Deque(std::initializer_list<T> init, const Alloc& alloc = Alloc())
       : alloc_(alloc) {
-    std::pair<size_t, size_t> real_index;
-    auto elem = init.begin();
-    start_allocate(init.size());
-    for (size_t i = 0; i < size_; ++i, ++elem) {
-      get_real_index(i, real_index);
-      alloc_traits::construct(
-          alloc_, &memory_[real_index.first][real_index.second], *elem);
-    }
+    fill(init.size(), [&](size_t i) -> const T& { return init.begin()[i]; });
   }
   ~Deque() {
     std::pair<size_t, size_t> ind;
@@ -182,19 +180,18 @@ class Deque {
       get_real_index(i, ind);
       alloc_traits::destroy(alloc_, &memory_[ind.first][ind.second]);
     }
-    for (size_t i = 0; i < memory_.size(); ++i) {
-      alloc_traits::deallocate(alloc_, memory_[i], kBucket);
-    }
+    release_buckets();
   }
   Deque& operator=(const Deque& other) {
     try {
-      Deque<T, Alloc> dop(other);
-      std::swap(memory_, dop.memory_);
-      std::swap(size_, dop.size_);
-      std::swap(index_bucket_start_, dop.index_bucket_start_);
-      std::swap(index_element_start_, dop.index_element_start_);
-      if (alloc_traits::propagate_on_container_copy_assignment::value) {
-        alloc_ = other.alloc_;
+      // dop is built with the allocator *this ends up with and takes the
+      // old buckets away together with the allocator that can free them.
+      constexpr bool propagate =
+          alloc_traits::propagate_on_container_copy_assignment::value;
+      Deque<T, Alloc> dop(other, propagate ? other.alloc_ : alloc_);
+      swap_storage(dop);
+      if constexpr (propagate) {
+        std::swap(alloc_, dop.alloc_);
       }
       return *this;
     } catch (...) {
@@ -204,13 +201,12 @@ class Deque {
   }
   Deque& operator=(Deque&& other) {
     try {
-      Deque<T, Alloc> dop = std::move(other);
-      std::swap(memory_, dop.memory_);
-      std::swap(size_, dop.size_);
-      std::swap(index_bucket_start_, dop.index_bucket_start_);
-      std::swap(index_element_start_, dop.index_element_start_);
-      if (alloc_traits::propagate_on_container_move_assignment::value) {
-        alloc_ = std::move(other.alloc_);
+      constexpr bool propagate =
+          alloc_traits::propagate_on_container_move_assignment::value;
+      Deque<T, Alloc> dop(std::move(other), propagate ? other.alloc_ : alloc_);
+      swap_storage(dop);
+      if constexpr (propagate) {
+        std::swap(alloc_, dop.alloc_);
       }
       return *this;
     } catch (...) {
@@ -248,64 +244,22 @@ class Deque {
     }
     return this->operator[](index);
   }
-  void push_back(const T& new_value) {
-    size_t size_before = size_;
-    try {
-      if (size_ == 0) {
-        start_allocate(0);
-      }
-      std::pair<size_t, size_t> real_index;
-      get_real_index(size_, real_index);
-      add_allocate_back(real_index);
-      alloc_traits::construct(
-          alloc_, &memory_[real_index.first][real_index.second], new_value);
-      size_++;
-    } catch (...) {
-      std::cout << "push_back_error" << std::endl;
-      throw;
-    }
-  }
-  void push_back(T&& new_value) {
-    size_t size_before = size_;
-    try {
-      if (size_ == 0) {
-        start_allocate(0);
-      }
-      std::pair<size_t, size_t> real_index;
-      get_real_index(size_, real_index);
-      add_allocate_back(real_index);
-      alloc_traits::construct(alloc_,
-                              &memory_[real_index.first][real_index.second],
-                              std::move(new_value));
-      size_++;
-    } catch (...) {
-      std::cout << "push_back_error" << std::endl;
-      throw;
-    }
-  }
-  template <typename... Args>
-  void emplace_back(const Args&... args) {
-    size_t size_before = size_;
-    try {
-      if (size_ == 0) {
-        start_allocate(0);
-      }
-      std::pair<size_t, size_t> real_index;
-      get_real_index(size_, real_index);
-      add_allocate_back(real_index);
-      alloc_traits::construct(
-          alloc_, &memory_[real_index.first][real_index.second], args...);
-      size_++;
-    } catch (...) {
-      std::cout << "push_back_error" << std::endl;
-      throw;
-    }
+  // Address of the element at `index` and, in `length`, how many slots its
+  // bucket has from there on: elements index..index + length - 1 lie one
+  // after another in memory as far as they exist. Lets neighbours be walked
+  // by pointer instead of translating every index.
+  T* contiguous(size_t index, size_t& length) {
+    std::pair<size_t, size_t> real_index;
+    get_real_index(index, real_index);
+    length = kBucket - real_index.second;
+    return &memory_[real_index.first][real_index.second];
   }
+  void push_back(const T& new_value) { emplace_back(new_value); }
+  void push_back(T&& new_value) { emplace_back(std::move(new_value)); }
   template <typename... Args>
   void emplace_back(Args&&... args) {
-    size_t size_before = size_;
     try {
-      if (size_ == 0) {
+      if (memory_.empty()) {
         start_allocate(0);
       }
       std::pair<size_t, size_t> real_index;
@@ -339,35 +293,33 @@ class Deque {
     if (index_element_start_ == kBucket - 1) {
       index_element_start_ = 0;
       index_bucket_start_++;
+    } else {
+      index_element_start_++;
     }
   }
-  void push_front(const T& new_value) {
+  void push_front(const T& new_value) { emplace_front(new_value); }
+  void push_front(T&& new_value) { emplace_front(std::move(new_value)); }
+  template <typename... Args>
+  void emplace_front(Args&&... args) {
     try {
-      if (size_ == 0) {
+      if (memory_.empty()) {
         start_allocate(0);
       }
       add_allocate_front();
-      alloc_traits::construct(
-          alloc_, &memory_[index_bucket_start_][index_element_start_],
-          new_value);
-      size_++;
-    } catch (...) {
-      std::cout << "push_front_error" << std::endl;
-      throw;
-    }
-  }
-  void push_front(T&& new_value) {
-    try {
-      if (size_ == 0) {
-        start_allocate(0);
+      try {
+        alloc_traits::construct(
+            alloc_, &memory_[index_bucket_start_][index_element_start_],
+            std::forward<Args>(args)...);
+      } catch (...) {
+        index_element_start_ = (index_element_start_ + 1) % kBucket;
+        if (index_element_start_ == 0) {
+          index_bucket_start_++;
+        }
+        throw;
       }
-      add_allocate_front();
-      alloc_traits::construct(
-          alloc_, &memory_[index_bucket_start_][index_element_start_],
-          std::move(new_value));
       size_++;
     } catch (...) {
-      std::cout << "push_back_error" << std::endl;
+      std::cout << "push_front_error" << std::endl;
       throw;
     }
   }
@@ -443,15 +395,9 @@ class Deque {
         second_index_ -= static_cast<size_t>(index);
         return *this;
       }
-      int index_withput_second = index - second_index_;
-      if (index_withput_second - kBucket * (index_withput_second / kBucket) >
-          0) {
-        first_index_ = first_index_ - index_withput_second / kBucket - 1;
-      } else {
-        first_index_ = first_index_ - index_withput_second / kBucket;
-      }
-      second_index_ = kBucket - (index_withput_second -
-                                 kBucket * (index_withput_second / kBucket));
+      size_t index_withput_second = index - second_index_;
+      first_index_ -= (index_withput_second + kBucket - 1) / kBucket;
+      second_index_ = (kBucket - index_withput_second % kBucket) % kBucket;
       return *this;
     }
     CommonIterator operator-(difference_type index) const {
@@ -519,22 +465,60 @@ class Deque {
   }
   reverse_iterator rbegin() { return reverse_iterator(end()); }
   reverse_iterator rend() { return reverse_iterator(begin()); }
-  void insert(iterator itr, const T& new_value) {
-    if (size_ == 0 || itr == end()) {
-      push_back(new_value);
-      return;
-    }
-    push_back(*(end() - 1));
-    for (auto it = end() - 1; it > itr; it--) {
-      *it = *(it - 1);
+  // Inserts a T(args...) before `pos`. At either end it is constructed in
+  // its slot and an exception leaves the deque as it was. In the middle, as
+  // in libstdc++'s deque, it is built as a temporary first, the elements
+  // between `pos` and the nearer end move one place towards that end, and
+  // the temporary is move-assigned into the slot they opened: args may
+  // refer to elements about to be moved, and a constructor throwing into an
+  // emptied slot would leave a hole. The middle path thus needs T to be
+  // move-assignable and costs one extra move. The element that lands in a
+  // new slot is moved only if its move constructor cannot throw (copied
+  // otherwise); a throwing move assignment leaves the elements valid but
+  // unspecified.
+  template <typename... Args>
+  iterator emplace(iterator pos, Args&&... args) {
+    size_t index = pos - begin();
+    if (index == size_) {
+      emplace_back(std::forward<Args>(args)...);
+      return begin() + index;
+    }
+    if (index == 0) {
+      emplace_front(std::forward<Args>(args)...);
+      return begin();
+    }
+    T value(std::forward<Args>(args)...);
+    if (index < size_ / 2) {
+      emplace_front(std::move_if_noexcept((*this)[0]));
+      iterator first = begin() + 1;
+      std::move(first + 1, first + index, first);
+    } else {
+      emplace_back(std::move_if_noexcept((*this)[size_ - 1]));
+      iterator last = end() - 1;
+      std::move_backward(begin() + index, last - 1, last);
     }
-    *itr = new_value;
+    iterator result = begin() + index;
+    *result = std::move(value);
+    return result;
+  }
+  iterator insert(iterator pos, const T& new_value) {
+    return emplace(pos, new_value);
   }
-  void erase(iterator itr) {
-    for (auto it = itr; it != end() - 1; it++) {
-      *it = *(it + 1);
+  iterator insert(iterator pos, T&& new_value) {
+    return emplace(pos, std::move(new_value));
+  }
+  // Moves the elements between `pos` and the nearer end one place over it
+  // and drops the slot left at that end.
+  iterator erase(iterator pos) {
+    size_t index = pos - begin();
+    if (index < size_ / 2) {
+      std::move_backward(begin(), pos, pos + 1);
+      pop_front();
+    } else {
+      std::move(pos + 1, end(), pos);
+      pop_back();
     }
-    pop_back();
+    return begin() + index;
   }
   Alloc& get_allocator() { return alloc_; }
 };
\ No newline at end of file
@@ -0,0 +1,232 @@
+/**
+ * @file priority_queue.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+#include "deque.hpp"
+
+// D-ary heap kept in a Deque: growing adds a bucket and never moves the
+// elements already stored, unlike a vector. The top is the element no other
+// element ranks above under Compare, so std::less gives the largest first,
+// as in std::priority_queue. A node's D children are adjacent, so a sift
+// step finds the first child once and walks its siblings by pointer inside
+// the bucket.
+//
+// push returns a handle that names the element until it is popped, wherever
+// sifting moves it; decrease_key moves an element towards the top through
+// its handle. The records behind handles of popped elements are reused, and
+// a handle carries the generation of its record, so a handle kept past its
+// pop never names the element that reuses the record: contains() is false
+// for it.
+template <typename T, typename Compare = std::less<T>, size_t D = 4>
+class PriorityQueue {
+ public:
+  struct Handle {
+    size_t record;
+    size_t generation;
+
+    bool operator==(const Handle& other) const {
+      return record == other.record && generation == other.generation;
+    }
+    bool operator!=(const Handle& other) const { return !(*this == other); }
+  };
+
+ private:
+  static_assert(D >= 2, "a heap needs at least two children per node");
+
+  struct Entry {
+    T value;
+    size_t record;
+  };
+
+  // Heap index of a handle's element, and the number of times the record
+  // was released; only handles of the current generation are live.
+  struct Record {
+    size_t position;
+    size_t generation;
+  };
+
+  Deque<Entry> heap_;
+  Deque<Record> records_;
+  Deque<size_t> free_;
+  Compare compare_;
+
+  // The position of the new record is left to the caller.
+  Handle take_handle() {
+    if (free_.empty()) {
+      records_.push_back(Record{0, 0});
+      return Handle{records_.size() - 1, 0};
+    }
+    size_t record = free_[free_.size() - 1];
+    free_.pop_back();
+    return Handle{record, records_[record].generation};
+  }
+
+  // Both sifts carry the element in `hole` and move the others through
+  // `slot`, the address of the free position, translating one index per
+  // level. Every element moved is written to records_ once, at the place
+  // it ends up, and the carried one only when it settles.
+  void sift_up(size_t index) {
+    Entry* slot = &heap_[index];
+    Entry hole = std::move(*slot);
+    while (index > 0) {
+      size_t parent = (index - 1) / D;
+      Entry* parent_slot = &heap_[parent];
+      if (!compare_(parent_slot->value, hole.value)) {
+        break;
+      }
+      *slot = std::move(*parent_slot);
+      records_[slot->record].position = index;
+      slot = parent_slot;
+      index = parent;
+    }
+    *slot = std::move(hole);
+    records_[slot->record].position = index;
+  }
+
+  void sift_down(size_t index) {
+    size_t size = heap_.size();
+    Entry* slot = &heap_[index];
+    Entry hole = std::move(*slot);
+    while (true) {
+      size_t first = D * index + 1;
+      if (first >= size) {
+        break;
+      }
+      size_t last = first + D < size ? first + D : size;
+      size_t length;
+      Entry* child = heap_.contiguous(first, length);
+      Entry* best = child;
+      size_t best_index = first;
+      for (size_t i = first + 1; i < last; ++i) {
+        if (--length == 0) {
+          child = heap_.contiguous(i, length);
+        } else {
+          ++child;
+        }
+        bool better = compare_(best->value, child->value);
+        best = better ? child : best;
+        best_index = better ? i : best_index;
+      }
+      if (!compare_(hole.value, best->value)) {
+        break;
+      }
+      *slot = std::move(*best);
+      records_[slot->record].position = index;
+      slot = best;
+      index = best_index;
+    }
+    *slot = std::move(hole);
+    records_[slot->record].position = index;
+  }
+
+  // Appends [first, last), handing each new handle to `sink`, and restores
+  // the heap: bottom-up (Floyd) when the batch is at least as large as what
+  // was there, which is O(n), and by sifting each new element up otherwise.
+  template <typename Iterator, typename Sink>
+  void append(Iterator first, Iterator last, Sink sink) {
+    size_t old_size = heap_.size();
+    for (; first != last; ++first) {
+      Handle handle = take_handle();
+      // Leaves no sift reaches keep this position.
+      records_[handle.record].position = heap_.size();
+      heap_.push_back(Entry{*first, handle.record});
+      sink(handle);
+    }
+    size_t added = heap_.size() - old_size;
+    if (added >= old_size) {
+      if (heap_.size() > 1) {
+        for (size_t index = (heap_.size() - 2) / D + 1; index-- > 0;) {
+          sift_down(index);
+        }
+      }
+      return;
+    }
+    for (size_t index = old_size; index < heap_.size(); ++index) {
+      sift_up(index);
+    }
+  }
+
+ public:
+  using value_type = T;
+
+  explicit PriorityQueue(const Compare& compare = Compare())
+      : compare_(compare) {}
+
+  size_t size() const { return heap_.size(); }
+  bool empty() const { return heap_.empty(); }
+
+  const T& top() const {
+    assert(!empty());
+    return heap_[0].value;
+  }
+
+  // sift_up records the position where the new element settles.
+  Handle push(const T& value) {
+    Handle handle = take_handle();
+    heap_.push_back(Entry{value, handle.record});
+    sift_up(heap_.size() - 1);
+    return handle;
+  }
+
+  Handle push(T&& value) {
+    Handle handle = take_handle();
+    heap_.push_back(Entry{std::move(value), handle.record});
+    sift_up(heap_.size() - 1);
+    return handle;
+  }
+
+  template <typename Iterator>
+  void push_bulk(Iterator first, Iterator last) {
+    append(first, last, [](Handle) {});
+  }
+
+  // Also writes the handle of every element, in order, to `handles`.
+  template <typename Iterator, typename Output>
+  Output push_bulk(Iterator first, Iterator last, Output handles) {
+    append(first, last, [&](Handle handle) { *handles++ = handle; });
+    return handles;
+  }
+
+  void pop() {
+    assert(!empty());
+    size_t record = heap_[0].record;
+    ++records_[record].generation;
+    free_.push_back(record);
+    if (heap_.size() > 1) {
+      heap_[0] = std::move(heap_[heap_.size() - 1]);
+      heap_.pop_back();
+      sift_down(0);
+    } else {
+      heap_.pop_back();
+    }
+  }
+
+  // False once the element of `handle` is popped, whether or not its
+  // record has been reused since.
+  bool contains(Handle handle) const {
+    return handle.record < records_.size() &&
+           records_[handle.record].generation == handle.generation;
+  }
+
+  const T& value(Handle handle) const {
+    assert(contains(handle));
+    return heap_[records_[handle.record].position].value;
+  }
+
+  // Replaces the value of `handle` with one that ranks no lower, i.e. for
+  // which compare(value, old) is false, and moves it up accordingly.
+  void decrease_key(Handle handle, T value) {
+    assert(contains(handle));
+    size_t index = records_[handle.record].position;
+    assert(!compare_(value, heap_[index].value));
+    heap_[index].value = std::move(value);
+    sift_up(index);
+  }
+};
@@ -0,0 +1,167 @@
+/**
+ * @file window_aggregator.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+#include "deque.hpp"
+
+// Monoids for WindowAggregator. A monoid names the type it aggregates into
+// and provides its identity, lift() from an event to an aggregate and an
+// associative combine(); combine need be neither commutative nor
+// invertible, so Min and Max work as well as Sum, and so does a sketch
+// (e.g. a histogram for percentiles) whose Aggregate differs from the event.
+namespace window {
+template <typename T>
+struct Sum {
+  using Aggregate = T;
+  Aggregate identity() const { return T(); }
+  Aggregate lift(const T& value) const { return value; }
+  Aggregate combine(const Aggregate& left, const Aggregate& right) const {
+    return left + right;
+  }
+};
+
+template <typename T>
+struct Min {
+  using Aggregate = T;
+  Aggregate identity() const { return std::numeric_limits<T>::max(); }
+  Aggregate lift(const T& value) const { return value; }
+  Aggregate combine(const Aggregate& left, const Aggregate& right) const {
+    return right < left ? right : left;
+  }
+};
+
+template <typename T>
+struct Max {
+  using Aggregate = T;
+  Aggregate identity() const { return std::numeric_limits<T>::lowest(); }
+  Aggregate lift(const T& value) const { return value; }
+  Aggregate combine(const Aggregate& left, const Aggregate& right) const {
+    return left < right ? right : left;
+  }
+};
+}  // namespace window
+
+// Sliding window of events with the aggregate of all of them, in arrival
+// order, in amortised O(1) per event: events arrive with push_back and
+// expire with pop_front, and query() combines them front to back.
+//
+// Two stacks over one deque (Two-Stacks Lite): the events at the front
+// keep, next to them, the aggregate of each one together with the rest of
+// the front part, and the events behind are folded into a single running
+// aggregate. Expiring an event drops its front aggregate; when the front
+// part runs out, it is rebuilt over every event in the window. Each event
+// is thus combined twice in all, though a single pop_front that triggers a
+// rebuild costs the size of the window.
+template <typename T, typename Monoid>
+class WindowAggregator {
+ public:
+  using Aggregate = typename Monoid::Aggregate;
+
+ private:
+  Deque<T> events_;
+  // suffixes_[suffixes_.size() - 1 - i] aggregates events_[i] up to the end
+  // of the front part, so the oldest event's is the last one and leaves
+  // with pop_back.
+  Deque<Aggregate> suffixes_;
+  Aggregate back_;  // Events behind the front part.
+  Monoid monoid_;
+
+  void rebuild() {
+    Aggregate running = monoid_.identity();
+    for (size_t i = events_.size(); i-- > 0;) {
+      running = monoid_.combine(monoid_.lift(events_[i]), running);
+      suffixes_.push_back(running);
+    }
+    back_ = monoid_.identity();
+  }
+
+ public:
+  using value_type = T;
+
+  explicit WindowAggregator(const Monoid& monoid = Monoid())
+      : back_(monoid.identity()), monoid_(monoid) {}
+
+  size_t size() const { return events_.size(); }
+  bool empty() const { return events_.empty(); }
+
+  // The oldest event in the window.
+  const T& front() const {
+    assert(!empty());
+    return events_[0];
+  }
+
+  // Aggregate of the whole window, the identity when it is empty.
+  Aggregate query() const {
+    if (suffixes_.empty()) {
+      return back_;
+    }
+    return monoid_.combine(suffixes_[suffixes_.size() - 1], back_);
+  }
+
+  void push_back(const T& event) {
+    back_ = monoid_.combine(back_, monoid_.lift(event));
+    events_.push_back(event);
+  }
+
+  void push_back(T&& event) {
+    back_ = monoid_.combine(back_, monoid_.lift(event));
+    events_.push_back(std::move(event));
+  }
+
+  // A batch of arrivals, oldest first.
+  template <typename Iterator>
+  void push_back(Iterator first, Iterator last) {
+    for (; first != last; ++first) {
+      push_back(*first);
+    }
+  }
+
+  void pop_front() {
+    assert(!empty());
+    if (suffixes_.empty()) {
+      rebuild();
+    }
+    suffixes_.pop_back();
+    events_.pop_front();
+  }
+
+  // Expires the `count` oldest events. A batch reaching past the front part
+  // discards the front aggregates, drops the rest and rebuilds once over
+  // what remains, instead of rebuilding over events about to go.
+  void pop_front(size_t count) {
+    assert(count <= size());
+    if (count <= suffixes_.size()) {
+      for (size_t i = 0; i < count; ++i) {
+        suffixes_.pop_back();
+        events_.pop_front();
+      }
+      return;
+    }
+    while (!suffixes_.empty()) {
+      suffixes_.pop_back();
+    }
+    for (size_t i = 0; i < count; ++i) {
+      events_.pop_front();
+    }
+    rebuild();
+  }
+
+  // Expires the oldest events for as long as `expired` holds for them, e.g.
+  // while their timestamp is older than the window, and returns how many.
+  template <typename Predicate>
+  size_t pop_front_while(Predicate expired) {
+    size_t count = 0;
+    while (count < events_.size() && expired(events_[count])) {
+      ++count;
+    }
+    pop_front(count);
+    return count;
+  }
+};
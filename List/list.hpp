@@ -5,6 +5,9 @@
 
 #pragma once
 #include <iostream>
+#include <memory>
+#include <type_traits>
+#include <utility>
 
 template <typename T, typename Alloc = std::allocator<T>>
 class List {
@@ -14,6 +17,7 @@ class List {
     Node* prev;
     Node* next;
     Node(const T& val) : value(val) {}
+    Node(T&& val) : value(std::move(val)) {}
     Node() {}
     ~Node() {}
   };
@@ -28,10 +32,64 @@ class List {
 
   node_alloc alloc_;
 
+  void release_if_empty() {
+    if (size_ == 0) {
+      node_alloc_traits::deallocate(alloc_, tail_, 1);
+      head_ = nullptr;
+      tail_ = nullptr;
+    }
+  }
+
+  void swap_nodes(List& other) {
+    std::swap(head_, other.head_);
+    std::swap(tail_, other.tail_);
+    std::swap(size_, other.size_);
+  }
+
+  // Builds the nodes of `other` with alloc_, moving the values out of it
+  // if it is passed as an rvalue.
+  template <typename Source>
+  void build_from(Source&& other) {
+    if (other.size_ == 0) {
+      return;
+    }
+    head_ = node_alloc_traits::allocate(alloc_, 1);
+    tail_ = head_;
+    Node* now_top = head_;
+
+    for (Node* node = other.head_; node != other.tail_; node = node->next) {
+      try {
+        if constexpr (std::is_lvalue_reference_v<Source>) {
+          node_alloc_traits::construct(alloc_, now_top,
+                                       std::as_const(node->value));
+        } else {
+          node_alloc_traits::construct(alloc_, now_top,
+                                       std::move(node->value));
+        }
+        Node* dop = node_alloc_traits::allocate(alloc_, 1);
+        now_top->next = dop;
+        dop->prev = now_top;
+        now_top = dop;
+        tail_ = now_top;
+      } catch (...) {
+        while (head_ != tail_) {
+          Node* old = head_;
+          head_ = head_->next;
+          node_alloc_traits::destroy(alloc_, old);
+          node_alloc_traits::deallocate(alloc_, old, 1);
+        }
+        node_alloc_traits::deallocate(alloc_, head_, 1);
+        throw;
+      }
+    }
+    size_ = other.size_;
+  }
+
  public:
   using value_type = T;
   using allocator_type = Alloc;
-  List() : size_(0), alloc_(Alloc()) {}
+  List() : List(Alloc()) {}
+  explicit List(const Alloc& alloc) : size_(0), alloc_(alloc) {}
   List(size_t count, const T& value, const Alloc& alloc = Alloc())
       : alloc_(alloc), size_(count) {
     size_ = count;
@@ -117,40 +175,46 @@ class List {
   }
 
   List(const List& other)
-      : alloc_(
-            alloc_traits::select_on_container_copy_construction(other.alloc_)),
-        size_(other.size()) {
-    head_ = node_alloc_traits::allocate(alloc_, 1);
-    Node* now_top = head_;
+      : List(other, alloc_traits::select_on_container_copy_construction(
+                        other.alloc_)) {}
 
-    for (auto it = other.begin(); it != other.end(); ++it) {
-      try {
-        node_alloc_traits::construct(alloc_, now_top, *it);
-        Node* dop = node_alloc_traits::allocate(alloc_, 1);
-        now_top->next = dop;
-        dop->prev = now_top;
-        now_top = dop;
-        tail_ = now_top;
-      } catch (...) {
-        while (head_ != tail_) {
-          Node* old = head_;
-          head_ = head_->next;
-          node_alloc_traits::destroy(alloc_, old);
-          node_alloc_traits::deallocate(alloc_, old, 1);
-        }
-        node_alloc_traits::deallocate(alloc_, head_, 1);
-        throw;
-      }
+  List(const List& other, const Alloc& alloc) : alloc_(alloc) {
+    build_from(other);
+  }
+
+  // The nodes move together with the allocator that owns them.
+  List(List&& other) : alloc_(std::move(other.alloc_)) { swap_nodes(other); }
+
+  // Takes the nodes of `other` if `alloc` can free them, and moves the
+  // values one by one into nodes of `alloc` otherwise.
+  List(List&& other, const Alloc& alloc) : alloc_(alloc) {
+    if (alloc_ == other.alloc_) {
+      swap_nodes(other);
+      return;
     }
+    build_from(std::move(other));
   }
 
+  // dop is built with the allocator *this ends up with and takes the old
+  // nodes away together with the allocator that can free them.
   List<T, Alloc>& operator=(const List<T, Alloc>& other) {
-    List<T, Alloc> dop(other);
-    std::swap(head_, dop.head_);
-    std::swap(tail_, dop.tail_);
-    std::swap(size_, dop.size_);
-    if (alloc_traits::propagate_on_container_copy_assignment::value) {
-      alloc_ = other.alloc_;
+    constexpr bool propagate =
+        alloc_traits::propagate_on_container_copy_assignment::value;
+    List<T, Alloc> dop(other, propagate ? other.alloc_ : alloc_);
+    swap_nodes(dop);
+    if constexpr (propagate) {
+      std::swap(alloc_, dop.alloc_);
+    }
+    return *this;
+  }
+
+  List<T, Alloc>& operator=(List<T, Alloc>&& other) {
+    constexpr bool propagate =
+        alloc_traits::propagate_on_container_move_assignment::value;
+    List<T, Alloc> dop(std::move(other), propagate ? other.alloc_ : alloc_);
+    swap_nodes(dop);
+    if constexpr (propagate) {
+      std::swap(alloc_, dop.alloc_);
     }
     return *this;
   }
@@ -162,7 +226,10 @@ class List {
       node_alloc_traits::destroy(alloc_, old);
       node_alloc_traits::deallocate(alloc_, old, 1);
     }
-    node_alloc_traits::deallocate(alloc_, head_, 1);
+    // A list that never held an element has no sentinel.
+    if (head_) {
+      node_alloc_traits::deallocate(alloc_, head_, 1);
+    }
   }
 
   size_t size() const { return size_; }
@@ -219,6 +286,7 @@ class List {
         dop = node_alloc_traits::allocate(alloc_, 1);
         node_alloc_traits::construct(alloc_, dop, value);
         dop->next = head_;
+        head_->prev = dop;
         head_ = dop;
       } catch (...) {
         node_alloc_traits::destroy(alloc_, dop);
@@ -228,12 +296,22 @@ class List {
     size_++;
   }
 
+  // tail_ is the sentinel past the last element, so pop_back unlinks the
+  // node before it. Popping the last element frees the sentinel as well,
+  // leaving the list as a default-constructed one, which push_back and
+  // push_front expect when size_ is 0.
   void pop_back() {
-    Node* old_tail = tail_;
-    tail_ = tail_->prev;
-    node_alloc_traits::destroy(alloc_, old_tail);
-    node_alloc_traits::deallocate(alloc_, old_tail, 1);
+    Node* old_back = tail_->prev;
+    if (old_back == head_) {
+      head_ = tail_;
+    } else {
+      old_back->prev->next = tail_;
+      tail_->prev = old_back->prev;
+    }
+    node_alloc_traits::destroy(alloc_, old_back);
+    node_alloc_traits::deallocate(alloc_, old_back, 1);
     size_--;
+    release_if_empty();
   }
 
   void pop_front() {
@@ -242,6 +320,7 @@ class List {
     node_alloc_traits::destroy(alloc_, old_head);
     node_alloc_traits::deallocate(alloc_, old_head, 1);
     size_--;
+    release_if_empty();
   }
 
   template <bool IsConst>
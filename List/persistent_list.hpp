@@ -0,0 +1,158 @@
+/**
+ * @file persistent_list.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <initializer_list>
+#include <iterator>
+
+#include "../SmartPointers/sm_pointers.hpp"
+
+// Immutable cons-list. Nodes are never modified after construction, so a copy
+// of the list is an O(1) snapshot that shares every node with the original.
+// With the default atomic counting policy snapshots may be read and dropped
+// on other threads while the writer keeps prepending.
+template <typename T, typename Policy = control_block::DefaultCount>
+class PersistentList {
+ private:
+  struct Node {
+    T value;
+    SharedPtr<Node, Policy> next;
+    size_t size;
+
+    template <typename... Args>
+    Node(SharedPtr<Node, Policy>&& tail, Args&&... args)
+        : value(std::forward<Args>(args)...),
+          next(std::move(tail)),
+          size(next.get() ? next->size + 1 : 1) {}
+
+    // Whichever thread's release destroys a node also drops the chain behind
+    // it, without recursing: the outermost ~Node on the thread releases the
+    // links one at a time, and a node that dies meanwhile only leaves its own
+    // link in the thread's slot for the outer loop to release next. No count
+    // is inspected, so it holds however the last owners race.
+    ~Node() {
+      bool& draining = Draining();
+      SharedPtr<Node, Policy>& pending = Pending();
+      if (draining) {
+        if (!pending.get()) {
+          pending = std::move(next);
+        }
+        return;
+      }
+      draining = true;
+      SharedPtr<Node, Policy> link = std::move(next);
+      while (link.get()) {
+        link.reset();
+        link = std::move(pending);
+      }
+      draining = false;
+    }
+
+    static bool& Draining() {
+      static thread_local bool draining = false;
+      return draining;
+    }
+
+    static SharedPtr<Node, Policy>& Pending() {
+      static thread_local SharedPtr<Node, Policy> pending;
+      return pending;
+    }
+  };
+
+  SharedPtr<Node, Policy> head_;
+
+ public:
+  using value_type = T;
+
+  PersistentList() = default;
+
+  PersistentList(std::initializer_list<T> init) {
+    for (auto it = std::rbegin(init); it != std::rend(init); ++it) {
+      push_front(*it);
+    }
+  }
+
+  PersistentList(const PersistentList& other) : head_(other.head_) {}
+
+  PersistentList(PersistentList&& other) : head_(std::move(other.head_)) {}
+
+  PersistentList& operator=(const PersistentList& other) {
+    PersistentList dop(other);
+    std::swap(head_, dop.head_);
+    return *this;
+  }
+
+  PersistentList& operator=(PersistentList&& other) {
+    PersistentList dop(std::move(other));
+    std::swap(head_, dop.head_);
+    return *this;
+  }
+
+  size_t size() const { return head_.get() ? head_->size : 0; }
+  bool empty() const { return head_.get() == nullptr; }
+
+  const T& front() const { return head_->value; }
+
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+
+  template <typename... Args>
+  void emplace_front(Args&&... args) {
+    head_ = MakeShared<Node, Policy>(std::move(head_),
+                                     std::forward<Args>(args)...);
+  }
+
+  void pop_front() { head_ = head_->next; }
+
+  PersistentList tail() const {
+    PersistentList result;
+    result.head_ = head_->next;
+    return result;
+  }
+
+  struct ConstIterator {
+   private:
+    const Node* node_;
+
+   public:
+    using value_type = const T;
+    using pointer = value_type*;
+    using reference = value_type&;
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+
+    ConstIterator(const Node* node) : node_(node) {}
+
+    reference operator*() const { return node_->value; }
+
+    pointer operator->() const { return &(node_->value); }
+
+    ConstIterator& operator++() {
+      node_ = node_->next.get();
+      return *this;
+    }
+
+    ConstIterator operator++(int) {
+      ConstIterator old = *this;
+      operator++();
+      return old;
+    }
+
+    bool operator==(const ConstIterator& other) const {
+      return node_ == other.node_;
+    }
+    bool operator!=(const ConstIterator& other) const {
+      return !(*this == other);
+    }
+  };
+
+  using const_iterator = ConstIterator;
+  using iterator = ConstIterator;
+
+  const_iterator begin() const { return const_iterator(head_.get()); }
+  const_iterator end() const { return const_iterator(nullptr); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+};
@@ -0,0 +1,146 @@
+/**
+ * @file atomic_sm_pointers.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <atomic>
+
+#include "hazard.hpp"
+#include "sm_pointers.hpp"
+
+// SharedPtr slot that many threads can read and replace without a lock.
+//
+// The slot points to an immutable heap Holder with the published SharedPtr.
+// Readers protect the Holder with a hazard pointer (see hazard.hpp), so a
+// read writes only a slot of the reader's own thread and nothing that other
+// readers touch: load() then copies the SharedPtr, which increments the
+// shared count of the object, and read() does not even do that. Writers
+// swap in a new Holder and retire the old one, which is deleted once no
+// reader announces it any more.
+template <typename T, typename Policy = control_block::DefaultCount>
+class AtomicSharedPtr {
+ private:
+  static_assert(Policy::kThreadSafe,
+                "AtomicSharedPtr needs a thread-safe counting policy");
+
+  struct Holder {
+    SharedPtr<T, Policy> value;
+
+    Holder(SharedPtr<T, Policy>&& new_value) : value(std::move(new_value)) {}
+  };
+
+  // Always points to a Holder, even for an empty pointer.
+  std::atomic<Holder*> holder_;
+
+  static bool same(const SharedPtr<T, Policy>& first,
+                   const SharedPtr<T, Policy>& second) {
+    return first.ptr_ == second.ptr_ &&
+           first.control_block_ == second.control_block_;
+  }
+
+ public:
+  // Access to the value published when read() was called, without touching
+  // its counts; the value stays alive while the Guard does. A Guard belongs
+  // to the thread that made it.
+  class Guard {
+   private:
+    hazard::Pointer hazard_;
+    const Holder* holder_;
+
+    friend class AtomicSharedPtr;
+
+    explicit Guard(const std::atomic<Holder*>& source)
+        : holder_(hazard_.protect(source)) {}
+
+   public:
+    using element_type = typename SharedPtr<T, Policy>::element_type;
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+    element_type* get() const { return holder_->value.get(); }
+    std::add_lvalue_reference_t<element_type> operator*() const {
+      return *get();
+    }
+    element_type* operator->() const { return get(); }
+
+    // A new owner of the value, for keeping it past the Guard.
+    SharedPtr<T, Policy> retain() const { return holder_->value; }
+  };
+
+  AtomicSharedPtr() : holder_(new Holder(SharedPtr<T, Policy>())) {}
+
+  AtomicSharedPtr(SharedPtr<T, Policy> desired)
+      : holder_(new Holder(std::move(desired))) {}
+
+  AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+  AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+  // Guards may outlive the slot, so its Holder is retired as well.
+  ~AtomicSharedPtr() {
+    hazard::Retire(holder_.load(std::memory_order_acquire));
+  }
+
+  bool is_lock_free() const { return holder_.is_lock_free(); }
+
+  Guard read() const { return Guard(holder_); }
+
+  SharedPtr<T, Policy> load() const {
+    hazard::Pointer hazard;
+    return hazard.protect(holder_)->value;
+  }
+
+  operator SharedPtr<T, Policy>() const { return load(); }
+
+  void store(SharedPtr<T, Policy> desired) {
+    hazard::Retire(holder_.exchange(new Holder(std::move(desired)),
+                                    std::memory_order_seq_cst));
+  }
+
+  AtomicSharedPtr& operator=(SharedPtr<T, Policy> desired) {
+    store(std::move(desired));
+    return *this;
+  }
+
+  SharedPtr<T, Policy> exchange(SharedPtr<T, Policy> desired) {
+    Holder* old = holder_.exchange(new Holder(std::move(desired)),
+                                   std::memory_order_seq_cst);
+    // Readers that protected the old Holder may still be copying its
+    // value, so it is copied out rather than moved.
+    SharedPtr<T, Policy> result(old->value);
+    hazard::Retire(old);
+    return result;
+  }
+
+  // Replaces the value with `desired` if it still shares both the pointer
+  // and the control block with `expected`; otherwise loads it into
+  // `expected`.
+  bool compare_exchange_strong(SharedPtr<T, Policy>& expected,
+                               SharedPtr<T, Policy> desired) {
+    hazard::Pointer hazard;
+    Holder* fresh = nullptr;
+    while (true) {
+      Holder* holder = hazard.protect(holder_);
+      if (!same(holder->value, expected)) {
+        expected = holder->value;
+        delete fresh;
+        return false;
+      }
+      if (!fresh) {
+        fresh = new Holder(std::move(desired));
+      }
+      if (holder_.compare_exchange_strong(holder, fresh,
+                                          std::memory_order_seq_cst)) {
+        hazard.reset();
+        hazard::Retire(holder);
+        return true;
+      }
+    }
+  }
+
+  bool compare_exchange_weak(SharedPtr<T, Policy>& expected,
+                             SharedPtr<T, Policy> desired) {
+    return compare_exchange_strong(expected, std::move(desired));
+  }
+};
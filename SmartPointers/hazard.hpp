@@ -0,0 +1,280 @@
+/**
+ * @file hazard.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace hazard {
+// Hazard pointers: a reader announces the object it is about to read in a
+// slot of its own thread, and a writer that unpublished an object only
+// retires it; retired objects are destroyed once no slot announces them.
+// Readers thus write nothing but their own slot, which no other reader
+// shares, and never wait for writers.
+//
+// Slots come in records of kSlots, one cache line each. A thread takes
+// records as it needs slots and returns them when it exits; records are
+// reused by later threads and kept for the lifetime of the process.
+static constexpr size_t kSlots = 8;
+
+struct alignas(64) Record {
+  std::atomic<const void*> slots[kSlots] = {};
+  std::atomic<bool> active{true};
+  Record* next = nullptr;
+  unsigned used = 0;  // Slots taken, touched by the owning thread only.
+};
+
+struct Retired {
+  void* object;
+  void (*destroy)(void*);
+};
+
+// Retired objects of threads that exited while some were still announced.
+struct Batch {
+  std::vector<Retired> retired;
+  Batch* next = nullptr;
+};
+
+class Domain {
+ private:
+  std::atomic<Record*> records_{nullptr};
+  std::atomic<size_t> record_count_{0};
+  std::atomic<Batch*> orphans_{nullptr};
+
+ public:
+  static Domain& instance() {
+    static Domain* domain = new Domain();
+    return *domain;
+  }
+
+  Record* acquire() {
+    for (Record* record = records_.load(std::memory_order_acquire); record;
+         record = record->next) {
+      bool active = false;
+      if (!record->active.load(std::memory_order_relaxed) &&
+          record->active.compare_exchange_strong(active, true,
+                                                 std::memory_order_acquire)) {
+        return record;
+      }
+    }
+    Record* record = new Record();
+    record->next = records_.load(std::memory_order_relaxed);
+    while (!records_.compare_exchange_weak(record->next, record,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+    record_count_.fetch_add(1, std::memory_order_relaxed);
+    return record;
+  }
+
+  void release(Record* record) {
+    for (auto& slot : record->slots) {
+      slot.store(nullptr, std::memory_order_relaxed);
+    }
+    record->used = 0;
+    record->active.store(false, std::memory_order_release);
+  }
+
+  size_t slot_count() const {
+    return record_count_.load(std::memory_order_relaxed) * kSlots;
+  }
+
+  // Everything announced right now, sorted.
+  std::vector<const void*> announced() const {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::vector<const void*> result;
+    for (Record* record = records_.load(std::memory_order_acquire); record;
+         record = record->next) {
+      for (const auto& slot : record->slots) {
+        if (const void* object = slot.load(std::memory_order_acquire)) {
+          result.push_back(object);
+        }
+      }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  void orphan(std::vector<Retired>&& retired) {
+    if (retired.empty()) {
+      return;
+    }
+    Batch* batch = new Batch{std::move(retired)};
+    batch->next = orphans_.load(std::memory_order_relaxed);
+    while (!orphans_.compare_exchange_weak(batch->next, batch,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+  }
+
+  void adopt(std::vector<Retired>& retired) {
+    Batch* batch = orphans_.exchange(nullptr, std::memory_order_acquire);
+    while (batch) {
+      retired.insert(retired.end(), batch->retired.begin(),
+                     batch->retired.end());
+      Batch* next = batch->next;
+      delete batch;
+      batch = next;
+    }
+  }
+};
+
+// Per-thread records and retired objects. Destroying objects can retire
+// more (an object that owns an AtomicSharedPtr), so scan() works on a
+// detached list and never runs nested.
+class Thread {
+ private:
+  std::vector<Record*> records_;
+  std::vector<Retired> retired_;
+  bool scanning_ = false;
+
+  static bool& exited() {
+    static thread_local bool flag = false;
+    return flag;
+  }
+
+ public:
+  ~Thread() {
+    exited() = true;
+    Domain& domain = Domain::instance();
+    for (Record* record : records_) {
+      domain.release(record);
+    }
+    scan();
+    domain.orphan(std::move(retired_));
+  }
+
+  // The calling thread's state, or nullptr while its thread-local objects
+  // are being destroyed.
+  static Thread* current() {
+    if (exited()) {
+      return nullptr;
+    }
+    static thread_local Thread thread;
+    return &thread;
+  }
+
+  std::atomic<const void*>* take(Record*& owner) {
+    for (Record* record : records_) {
+      if (record->used != (1u << kSlots) - 1) {
+        size_t index = 0;
+        while (record->used & (1u << index)) {
+          ++index;
+        }
+        record->used |= 1u << index;
+        owner = record;
+        return &record->slots[index];
+      }
+    }
+    records_.push_back(Domain::instance().acquire());
+    return take(owner);
+  }
+
+  void give_back(Record* record, std::atomic<const void*>* slot) {
+    slot->store(nullptr, std::memory_order_release);
+    record->used &= ~(1u << (slot - record->slots));
+  }
+
+  void retire(Retired retired) {
+    retired_.push_back(retired);
+    if (retired_.size() >= 2 * Domain::instance().slot_count() + 64) {
+      scan();
+    }
+  }
+
+  void scan() {
+    if (scanning_) {
+      return;
+    }
+    scanning_ = true;
+    std::vector<Retired> pending;
+    pending.swap(retired_);
+    Domain& domain = Domain::instance();
+    domain.adopt(pending);
+    std::vector<const void*> announced = domain.announced();
+    for (const Retired& retired : pending) {
+      if (std::binary_search(announced.begin(), announced.end(),
+                             retired.object)) {
+        retired_.push_back(retired);
+      } else {
+        retired.destroy(retired.object);
+      }
+    }
+    scanning_ = false;
+  }
+};
+
+// One slot, held for the lifetime of the Pointer on the thread that made
+// it. Pointers made while the thread is exiting borrow a whole record.
+class Pointer {
+ private:
+  Record* record_ = nullptr;
+  std::atomic<const void*>* slot_;
+  bool borrowed_ = false;
+
+ public:
+  Pointer() {
+    if (Thread* thread = Thread::current()) {
+      slot_ = thread->take(record_);
+    } else {
+      record_ = Domain::instance().acquire();
+      slot_ = &record_->slots[0];
+      borrowed_ = true;
+    }
+  }
+
+  Pointer(const Pointer&) = delete;
+  Pointer& operator=(const Pointer&) = delete;
+
+  ~Pointer() {
+    if (borrowed_) {
+      Domain::instance().release(record_);
+    } else if (Thread* thread = Thread::current()) {
+      thread->give_back(record_, slot_);
+    }
+  }
+
+  // Reads `source` and announces the value, repeating until the value is
+  // still in `source` after the announcement: from then on it cannot be
+  // destroyed before the announcement is withdrawn.
+  template <typename T>
+  T* protect(const std::atomic<T*>& source) {
+    T* object = source.load(std::memory_order_relaxed);
+    while (true) {
+      slot_->store(object, std::memory_order_seq_cst);
+      T* again = source.load(std::memory_order_seq_cst);
+      if (again == object) {
+        return object;
+      }
+      object = again;
+    }
+  }
+
+  void reset() { slot_->store(nullptr, std::memory_order_release); }
+};
+
+// Destroys `object` with `delete` once no hazard pointer announces it.
+template <typename T>
+void Retire(T* object) {
+  Retired retired{object,
+                  [](void* pointer) { delete static_cast<T*>(pointer); }};
+  if (Thread* thread = Thread::current()) {
+    thread->retire(retired);
+  } else {
+    Domain::instance().orphan(std::vector<Retired>{retired});
+  }
+}
+
+// Destroys what the calling thread and exited threads retired and nobody
+// announces any more, e.g. at a quiescent point instead of at the next
+// threshold.
+inline void Scan() {
+  if (Thread* thread = Thread::current()) {
+    thread->scan();
+  }
+}
+}  // namespace hazard
@@ -0,0 +1,215 @@
+/**
+ * @file intrusive_ptr.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "sm_pointers.hpp"
+
+template <typename T>
+class IntrusivePtr;
+
+// CRTP base that embeds the reference count in the object itself, counted
+// with any of the control_block policies that only count. There is no
+// control block: the object is created by one `new`, served by the same
+// size-class pool as MakeShared, and deleted as a T when the last
+// IntrusivePtr goes away, so deleting a derived object through
+// IntrusivePtr<T> needs a virtual destructor in T. Copies of the object get
+// a count of their own.
+template <typename T, typename Policy = control_block::DefaultCount>
+class RefCounted {
+ private:
+  static_assert(!Policy::kReleasesBlock,
+                "RefCounted needs a policy that only counts");
+
+  mutable typename Policy::count_type ref_count_{0};
+
+  template <typename U> friend class IntrusivePtr;
+
+  void add_ref() const { Policy::increment(ref_count_); }
+
+  void release_ref() const {
+    if (Policy::decrement(ref_count_) == 0) {
+      delete static_cast<const T*>(this);
+    }
+  }
+
+ protected:
+  RefCounted() {}
+  RefCounted(const RefCounted&) {}
+  RefCounted& operator=(const RefCounted&) { return *this; }
+  ~RefCounted() = default;
+
+ public:
+  size_t use_count() const { return Policy::load(ref_count_); }
+
+  static void* operator new(size_t bytes) {
+    if (bytes <= pool::kMaxBlockSize) {
+      return pool::Allocate(bytes);
+    }
+    return ::operator new(bytes);
+  }
+
+  static void* operator new(size_t bytes, std::align_val_t align) {
+    return ::operator new(bytes, align);
+  }
+
+  static void operator delete(void* ptr, size_t bytes) {
+    if (bytes <= pool::kMaxBlockSize) {
+      pool::Deallocate(ptr, bytes);
+      return;
+    }
+    ::operator delete(ptr);
+  }
+
+  static void operator delete(void* ptr, size_t, std::align_val_t align) {
+    ::operator delete(ptr, align);
+  }
+};
+
+template <typename T>
+class IntrusivePtr {
+ public:
+  using element_type = T;
+
+ private:
+  T* ptr_ = nullptr;
+
+  template <typename U> friend class IntrusivePtr;
+
+ public:
+  IntrusivePtr() {}
+  IntrusivePtr(std::nullptr_t) {}
+
+  // Takes a new reference to `ptr`, which may already be owned by other
+  // IntrusivePtrs; with add_ref = false adopts one counted before, e.g. by
+  // detach().
+  IntrusivePtr(T* ptr, bool add_ref = true) : ptr_(ptr) {
+    if (ptr_ && add_ref) {
+      ptr_->add_ref();
+    }
+  }
+
+  IntrusivePtr(const IntrusivePtr& other) : ptr_(other.ptr_) {
+    if (ptr_) {
+      ptr_->add_ref();
+    }
+  }
+
+  template <typename Y>
+  IntrusivePtr(const IntrusivePtr<Y>& other) : ptr_(other.ptr_) {
+    if (ptr_) {
+      ptr_->add_ref();
+    }
+  }
+
+  IntrusivePtr(IntrusivePtr&& other)
+      : ptr_(std::exchange(other.ptr_, nullptr)) {}
+
+  template <typename Y>
+  IntrusivePtr(IntrusivePtr<Y>&& other)
+      : ptr_(std::exchange(other.ptr_, nullptr)) {}
+
+  ~IntrusivePtr() {
+    if (ptr_) {
+      ptr_->release_ref();
+    }
+  }
+
+  IntrusivePtr& operator=(const IntrusivePtr& other) {
+    IntrusivePtr dop(other);
+    swap(dop);
+    return *this;
+  }
+
+  template <typename Y>
+  IntrusivePtr& operator=(const IntrusivePtr<Y>& other) {
+    IntrusivePtr dop(other);
+    swap(dop);
+    return *this;
+  }
+
+  IntrusivePtr& operator=(IntrusivePtr&& other) {
+    IntrusivePtr dop(std::move(other));
+    swap(dop);
+    return *this;
+  }
+
+  template <typename Y>
+  IntrusivePtr& operator=(IntrusivePtr<Y>&& other) {
+    IntrusivePtr dop(std::move(other));
+    swap(dop);
+    return *this;
+  }
+
+  void swap(IntrusivePtr& other) { std::swap(ptr_, other.ptr_); }
+
+  void reset() {
+    IntrusivePtr dop;
+    swap(dop);
+  }
+
+  void reset(T* ptr) {
+    IntrusivePtr dop(ptr);
+    swap(dop);
+  }
+
+  // Gives up the pointer without releasing its reference.
+  T* detach() { return std::exchange(ptr_, nullptr); }
+
+  size_t use_count() const {
+    if (!ptr_) {
+      return 0;
+    }
+    return ptr_->use_count();
+  }
+
+  T* get() const { return ptr_; }
+
+  T& operator*() const { return *ptr_; }
+
+  T* operator->() const { return ptr_; }
+};
+
+template <typename T, typename... Args>
+IntrusivePtr<T> MakeIntrusive(Args&&... args) {
+  return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> StaticPointerCast(const IntrusivePtr<U>& ptr) {
+  return IntrusivePtr<T>(static_cast<T*>(ptr.get()));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> StaticPointerCast(IntrusivePtr<U>&& ptr) {
+  return IntrusivePtr<T>(static_cast<T*>(ptr.detach()), false);
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> DynamicPointerCast(const IntrusivePtr<U>& ptr) {
+  return IntrusivePtr<T>(dynamic_cast<T*>(ptr.get()));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> DynamicPointerCast(IntrusivePtr<U>&& ptr) {
+  if (T* cast = dynamic_cast<T*>(ptr.get())) {
+    ptr.detach();
+    return IntrusivePtr<T>(cast, false);
+  }
+  return IntrusivePtr<T>();
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> ConstPointerCast(const IntrusivePtr<U>& ptr) {
+  return IntrusivePtr<T>(const_cast<T*>(ptr.get()));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> ConstPointerCast(IntrusivePtr<U>&& ptr) {
+  return IntrusivePtr<T>(const_cast<T*>(ptr.detach()), false);
+}
@@ -0,0 +1,273 @@
+/**
+ * @file pool_allocator.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace pool {
+// Blocks are served from size classes of kGranularity bytes up to
+// kMaxBlockSize; larger or over-aligned requests go to operator new.
+static constexpr size_t kGranularity = 16;
+static constexpr size_t kMaxBlockSize = 512;
+static constexpr size_t kClasses = kMaxBlockSize / kGranularity;
+static constexpr size_t kBatch = 32;
+static constexpr size_t kChunkSize = 64 * 1024;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct PoolStats {
+  size_t central_locks;
+  size_t contended_locks;
+  size_t chunks;
+};
+
+// Empty requests share the smallest class, so every pointer handed out is
+// distinct and can be freed with the size it was asked for.
+inline size_t ClassOf(size_t bytes) {
+  if (bytes == 0) {
+    return 0;
+  }
+  return (bytes + kGranularity - 1) / kGranularity - 1;
+}
+
+inline size_t BlockSize(size_t size_class) {
+  return (size_class + 1) * kGranularity;
+}
+
+// Shared free lists, one per size class, each behind its own mutex. Threads
+// only come here in batches of kBatch blocks. Chunks are kept for the
+// lifetime of the process.
+class Central {
+ private:
+  struct Class {
+    std::mutex mutex;
+    FreeBlock* head = nullptr;
+  };
+
+  Class classes_[kClasses];
+  std::atomic<size_t> central_locks_{0};
+  std::atomic<size_t> contended_locks_{0};
+  std::atomic<size_t> chunks_{0};
+
+  std::unique_lock<std::mutex> lock(Class& size_class) {
+    central_locks_.fetch_add(1, std::memory_order_relaxed);
+    std::unique_lock<std::mutex> guard(size_class.mutex, std::try_to_lock);
+    if (!guard.owns_lock()) {
+      contended_locks_.fetch_add(1, std::memory_order_relaxed);
+      guard.lock();
+    }
+    return guard;
+  }
+
+  FreeBlock* carve(size_t size_class) {
+    size_t block_size = BlockSize(size_class);
+    char* chunk = static_cast<char*>(::operator new(kChunkSize));
+    chunks_.fetch_add(1, std::memory_order_relaxed);
+    FreeBlock* head = nullptr;
+    for (size_t i = kChunkSize / block_size; i > 0; --i) {
+      FreeBlock* block =
+          reinterpret_cast<FreeBlock*>(chunk + (i - 1) * block_size);
+      block->next = head;
+      head = block;
+    }
+    return head;
+  }
+
+ public:
+  static Central& instance() {
+    static Central* central = new Central();
+    return *central;
+  }
+
+  // Hands out up to kBatch blocks as a list and stores their number in
+  // `count`.
+  FreeBlock* take(size_t size_class, size_t& count) {
+    Class& list = classes_[size_class];
+    auto guard = lock(list);
+    if (!list.head) {
+      list.head = carve(size_class);
+    }
+    FreeBlock* head = list.head;
+    FreeBlock* last = head;
+    count = 1;
+    while (count < kBatch && last->next) {
+      last = last->next;
+      ++count;
+    }
+    list.head = last->next;
+    last->next = nullptr;
+    return head;
+  }
+
+  void give(size_t size_class, FreeBlock* head, FreeBlock* last) {
+    Class& list = classes_[size_class];
+    auto guard = lock(list);
+    last->next = list.head;
+    list.head = head;
+  }
+
+  PoolStats stats() const {
+    return {central_locks_.load(std::memory_order_relaxed),
+            contended_locks_.load(std::memory_order_relaxed),
+            chunks_.load(std::memory_order_relaxed)};
+  }
+};
+
+// Per-thread free lists. A block freed on another thread than the one that
+// allocated it goes to the freeing thread's cache; caches above 2 * kBatch
+// blocks send a batch back to Central, so memory drifts back to the threads
+// that allocate.
+class ThreadCache {
+ private:
+  struct List {
+    FreeBlock* head = nullptr;
+    size_t count = 0;
+  };
+
+  List lists_[kClasses];
+
+  static bool& destroyed() {
+    static thread_local bool flag = false;
+    return flag;
+  }
+
+  void flush(size_t size_class, size_t count) {
+    List& list = lists_[size_class];
+    FreeBlock* head = list.head;
+    FreeBlock* last = head;
+    for (size_t i = 1; i < count; ++i) {
+      last = last->next;
+    }
+    list.head = last->next;
+    list.count -= count;
+    Central::instance().give(size_class, head, last);
+  }
+
+ public:
+  ~ThreadCache() {
+    for (size_t i = 0; i < kClasses; ++i) {
+      if (lists_[i].count) {
+        flush(i, lists_[i].count);
+      }
+    }
+    destroyed() = true;
+  }
+
+  // Null once the thread's cache is gone, e.g. for SharedPtrs released by
+  // thread_local destructors that run after it.
+  static ThreadCache* local() {
+    if (destroyed()) {
+      return nullptr;
+    }
+    static thread_local ThreadCache cache;
+    return &cache;
+  }
+
+  void* allocate(size_t size_class) {
+    List& list = lists_[size_class];
+    if (!list.head) {
+      list.head = Central::instance().take(size_class, list.count);
+    }
+    FreeBlock* block = list.head;
+    list.head = block->next;
+    --list.count;
+    return block;
+  }
+
+  void deallocate(void* ptr, size_t size_class) {
+    List& list = lists_[size_class];
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = list.head;
+    list.head = block;
+    if (++list.count > 2 * kBatch) {
+      flush(size_class, kBatch);
+    }
+  }
+};
+
+inline void* Allocate(size_t bytes) {
+  size_t size_class = ClassOf(bytes);
+  if (ThreadCache* cache = ThreadCache::local()) {
+    return cache->allocate(size_class);
+  }
+  size_t count = 0;
+  FreeBlock* head = Central::instance().take(size_class, count);
+  if (head->next) {
+    FreeBlock* last = head->next;
+    while (last->next) {
+      last = last->next;
+    }
+    Central::instance().give(size_class, head->next, last);
+  }
+  return head;
+}
+
+inline void Deallocate(void* ptr, size_t bytes) {
+  size_t size_class = ClassOf(bytes);
+  if (ThreadCache* cache = ThreadCache::local()) {
+    cache->deallocate(ptr, size_class);
+    return;
+  }
+  FreeBlock* block = static_cast<FreeBlock*>(ptr);
+  Central::instance().give(size_class, block, block);
+}
+
+inline PoolStats Stats() { return Central::instance().stats(); }
+
+// Stateless allocator over the size-class pool, used by MakeShared for its
+// control blocks.
+template <typename T>
+struct PoolAllocator {
+  using value_type = T;
+
+  PoolAllocator() = default;
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) {}
+
+  static constexpr size_t max_size() {
+    return static_cast<size_t>(-1) / sizeof(T);
+  }
+
+  static constexpr bool pooled(size_t n) {
+    return alignof(T) <= kGranularity && n <= kMaxBlockSize / sizeof(T);
+  }
+
+  // Throws std::bad_array_new_length, as std::allocator does, when
+  // n * sizeof(T) does not fit in size_t.
+  T* allocate(size_t n) {
+    if (n > max_size()) {
+      throw std::bad_array_new_length();
+    }
+    if (pooled(n)) {
+      return static_cast<T*>(pool::Allocate(n * sizeof(T)));
+    }
+    return static_cast<T*>(
+        ::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    if (pooled(n)) {
+      pool::Deallocate(ptr, n * sizeof(T));
+      return;
+    }
+    ::operator delete(ptr, std::align_val_t(alignof(T)));
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const PoolAllocator<U>&) const {
+    return false;
+  }
+};
+}; // namespace pool
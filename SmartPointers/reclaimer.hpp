@@ -0,0 +1,65 @@
+/**
+ * @file reclaimer.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "sm_pointers.hpp"
+
+// Background thread that destroys the objects retired by a
+// control_block::Deferred policy every `interval`. The destructor stops the
+// thread and drains what is left, so objects released before it runs are
+// never leaked.
+template <typename Policy = control_block::Deferred<>>
+class Reclaimer {
+ private:
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+  bool pending_ = false;
+  std::chrono::microseconds interval_;
+  std::thread thread_;
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+      wake_.wait_for(lock, interval_, [this] { return stop_ || pending_; });
+      pending_ = false;
+      lock.unlock();
+      Policy::drain();
+      lock.lock();
+    }
+  }
+
+ public:
+  explicit Reclaimer(std::chrono::microseconds interval =
+                         std::chrono::milliseconds(1))
+      : interval_(interval), thread_([this] { run(); }) {}
+
+  Reclaimer(const Reclaimer&) = delete;
+  Reclaimer& operator=(const Reclaimer&) = delete;
+
+  ~Reclaimer() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+    Policy::drain();
+  }
+
+  // Starts a pass now instead of at the end of the interval.
+  void wake() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_ = true;
+    }
+    wake_.notify_one();
+  }
+};
@@ -4,102 +4,850 @@
  */
 
 #pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "pool_allocator.hpp"
+#include "telemetry.hpp"
 
 namespace control_block {
-template <typename T> struct Counter {
-public:
-  size_t count_shared = 0;
-  size_t count_weak = 0;
-  T* object_ptr;
+// Counting policies. AtomicCount makes copies and releases of pointers that
+// share a control block safe across threads; NonAtomicCount keeps plain
+// counters for objects that never leave one thread.
+//
+// A policy with kReleasesBlock = false only counts: the block is destroyed by
+// whoever drops the shared count to zero. Policies with kReleasesBlock = true
+// take the whole release over through release(Counter<Policy>*).
+struct NonAtomicCount {
+  static constexpr bool kThreadSafe = false;
+  static constexpr bool kSupportsWeak = true;
+  static constexpr bool kReleasesBlock = false;
+  using count_type = unsigned int;
+
+  static void increment(count_type& count) { ++count; }
+  static size_t decrement(count_type& count) { return --count; }
+  static size_t load(const count_type& count) { return count; }
+  static bool increment_if_nonzero(count_type& count) {
+    if (count == 0) {
+      return false;
+    }
+    ++count;
+    return true;
+  }
+};
+
+struct AtomicCount {
+  static constexpr bool kThreadSafe = true;
+  static constexpr bool kSupportsWeak = true;
+  static constexpr bool kReleasesBlock = false;
+  using count_type = std::atomic<unsigned int>;
+
+  // A new reference is always made from an existing one, so the increment
+  // needs no ordering; the decrement that drops the count to zero has to see
+  // every write made through the other references before destruction.
+  static void increment(count_type& count) {
+    count.fetch_add(1, std::memory_order_relaxed);
+  }
+  static size_t decrement(count_type& count) {
+    return count.fetch_sub(1, std::memory_order_acq_rel) - 1;
+  }
+  static size_t load(const count_type& count) {
+    return count.load(std::memory_order_acquire);
+  }
+  static bool increment_if_nonzero(count_type& count) {
+    unsigned int now = count.load(std::memory_order_relaxed);
+    while (now != 0) {
+      if (count.compare_exchange_weak(now, now + 1, std::memory_order_acq_rel,
+                                      std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+template <typename Policy>
+struct Counter;
+
+// Biased reference counting. The thread that creates a block owns it and
+// counts its own references in a plain integer; other threads count theirs
+// in an atomic word, so copies on the owner cost the same as NonAtomicCount.
+// The object is alive while the sum of both halves is non-zero:
+//  - when the owner's count drops to zero it merges the halves and from then
+//    on everybody uses the atomic word;
+//  - a thread that drives the atomic half negative cannot see the owner's
+//    half, so it queues the block to the owner, who merges it later (see
+//    drain()). Blocks of threads that have exited are merged by the thread
+//    that would have queued them.
+// The bookkeeping does not extend to weak references.
+struct BiasedCount {
+  static constexpr bool kThreadSafe = true;
+  static constexpr bool kSupportsWeak = false;
+  static constexpr bool kReleasesBlock = true;
+
+  using Block = Counter<BiasedCount>;
+
+  // The atomic half counts in units of kOne and keeps two flags below them.
+  static constexpr intptr_t kMerged = 1;
+  static constexpr intptr_t kQueued = 2;
+  static constexpr intptr_t kOne = 4;
+
+  // Blocks queued to their owner. A record is referenced by its thread while
+  // the thread runs and by every block it owns, since blocks can outlive the
+  // thread; the last of them puts it on a free list for the next thread.
+  struct Owner {
+    std::atomic<Block*> queue;
+    std::atomic<size_t> references{1};
+    Owner* next_free = nullptr;
+
+    Owner(Block* head = nullptr) : queue(head) {}
+  };
+
+  struct count_type {
+    count_type(unsigned int count) : owner(attach()), biased(count) {}
+    ~count_type() { release_owner(owner); }
+
+    Owner* const owner;
+    unsigned int biased;
+    std::atomic<intptr_t> shared{0};
+    Block* next_queued = nullptr;
+  };
+
+  static void increment(count_type& count) {
+    if (count.owner == current() && count.biased != 0) {
+      ++count.biased;
+    } else {
+      count.shared.fetch_add(kOne, std::memory_order_relaxed);
+    }
+  }
+
+  // Exact on the owner thread and after the merge. Before the merge other
+  // threads cannot see the owner's half and report at least 2, so that
+  // use_count() == 1 never holds while the owner may keep a reference.
+  static size_t load(const count_type& count) {
+    intptr_t word = count.shared.load(std::memory_order_acquire);
+    intptr_t shared = count_of(word);
+    if (count.owner == current() && count.biased != 0) {
+      return count.biased + shared;
+    }
+    if (word & kMerged) {
+      return shared;
+    }
+    return (shared > 0 ? shared : 0) + 2;
+  }
+
+  static void release(Block* block);
+
+  // Merges the blocks other threads have queued to the calling thread.
+  // Owners drain whenever they create a block or merge one of their own;
+  // threads that do neither for a long time can call it themselves.
+  static void drain();
+
+  // Owner records allocated so far. Records are recycled, so this follows
+  // the number of threads whose blocks are alive at once, not the number of
+  // threads that ever created one.
+  static size_t owner_records() {
+    FreeOwners& owners = free_owners();
+    std::lock_guard<std::mutex> lock(owners.mutex);
+    return owners.allocated;
+  }
+
+ private:
+  struct Detach {
+    ~Detach();
+  };
+
+  static intptr_t count_of(intptr_t word) {
+    return (word & ~(kOne - 1)) / kOne;
+  }
+
+  static Owner*& current() {
+    static thread_local Owner* owner = nullptr;
+    return owner;
+  }
+
+  static bool& exited() {
+    static thread_local bool flag = false;
+    return flag;
+  }
+
+  static Block* closed_mark() { return reinterpret_cast<Block*>(kOne); }
+
+  // Never released: it starts with a reference nobody drops.
+  static Owner& closed() {
+    static Owner owner(closed_mark());
+    return owner;
+  }
+
+  struct FreeOwners {
+    std::mutex mutex;
+    Owner* head = nullptr;
+    size_t allocated = 0;
+  };
+
+  static FreeOwners& free_owners() {
+    static FreeOwners* owners = new FreeOwners();
+    return *owners;
+  }
+
+  static Owner* new_owner();
+  static void release_owner(Owner* owner);
+  static Owner* attach();
+  static void hand_off(Block* block);
+  static void settle(Block* block);
+  static void settle_list(Block* head);
+};
+
+// Drops the weak count from the control block of any policy. WeakPtr cannot
+// be used with such pointers, and the last release frees the block in a
+// single call.
+template <typename Policy>
+struct WeakLess : Policy {
+  static constexpr bool kSupportsWeak = false;
+};
+
+using DefaultCount = AtomicCount;
+
+// Stores an empty, non-final T as a base class so that stateless deleters
+// and allocators take no space in the control block.
+template <typename T, int Index,
+          bool = std::is_empty<T>::value && !std::is_final<T>::value>
+struct EboStorage {
+  T value;
+
+  EboStorage(const T& new_value) : value(new_value) {}
+  T& get() { return value; }
+};
+
+template <typename T, int Index>
+struct EboStorage<T, Index, true> : private T {
+  EboStorage(const T& new_value) : T(new_value) {}
+  T& get() { return *this; }
+};
+
+enum Action : unsigned int { kDeletePtr = 1, kDeallocateBlock = 2 };
+
+// Instead of a vtable every block stores one function pointer that destroys
+// the object, frees the block, or both in a single call.
+template <typename Policy>
+struct Dispatch {
+  void (*manage)(Counter<Policy>* block, unsigned int action);
+#ifdef SM_POINTERS_TELEMETRY
+  telemetry::Type* type;
+#endif
+};
+
+// count_weak holds one extra reference on behalf of all shared owners, so the
+// block is freed exactly once even if the last SharedPtr and the last WeakPtr
+// are released concurrently.
+template <typename Policy, bool = Policy::kSupportsWeak>
+struct Counts : Dispatch<Policy> {
+  typename Policy::count_type count_shared{1};
+  typename Policy::count_type count_weak{1};
+};
+
+template <typename Policy>
+struct Counts<Policy, false> : Dispatch<Policy> {
+  typename Policy::count_type count_shared{1};
+};
+
+// Type-erased header shared by all control blocks. The pointer to the
+// managed object lives in SharedPtr itself.
+template <typename Policy>
+struct Counter : Counts<Policy> {
+  // Called by the block constructors with the type of the owned object.
+  template <typename Object>
+  void track(size_t bytes) {
+#ifdef SM_POINTERS_TELEMETRY
+    this->type = &telemetry::TypeOf<Object>();
+    this->type->created(bytes);
+#else
+    (void)bytes;
+#endif
+  }
+
+  void add_shared() {
+#ifdef SM_POINTERS_TELEMETRY
+    this->type->add(telemetry::kIncrements);
+#endif
+    Policy::increment(this->count_shared);
+  }
+
+  // Takes a shared reference for a weak owner while the object is alive.
+  bool promote() {
+    bool promoted = Policy::increment_if_nonzero(this->count_shared);
+#ifdef SM_POINTERS_TELEMETRY
+    this->type->add(promoted ? telemetry::kPromotions
+                             : telemetry::kFailedPromotions);
+#endif
+    return promoted;
+  }
+
+  void release_shared() {
+#ifdef SM_POINTERS_TELEMETRY
+    this->type->add(telemetry::kDecrements);
+#endif
+    if constexpr (Policy::kReleasesBlock) {
+      Policy::release(this);
+    } else if (Policy::decrement(this->count_shared) == 0) {
+      destroy();
+    }
+  }
+
+  // Runs once the shared count has dropped to zero.
+  void destroy() {
+    unsigned int action = kDeletePtr | kDeallocateBlock;
+    if constexpr (Policy::kSupportsWeak) {
+      // Without weak owners nobody can observe the block any more.
+      if (Policy::load(this->count_weak) != 1) {
+        action = kDeletePtr;
+      }
+    }
+#ifdef SM_POINTERS_TELEMETRY
+    // Includes freeing the block when both happen in one call.
+    telemetry::Type* type = this->type;
+    auto start = std::chrono::steady_clock::now();
+    this->manage(this, action);
+    type->destroyed(telemetry::NanosSince(start));
+#else
+    this->manage(this, action);
+#endif
+    if constexpr (Policy::kSupportsWeak) {
+      if (action == kDeletePtr) {
+        release_weak();
+      }
+    }
+  }
+
+  void add_weak() { Policy::increment(this->count_weak); }
+
+  void release_weak() {
+    if (Policy::decrement(this->count_weak) == 0) {
+      this->manage(this, kDeallocateBlock);
+    }
+  }
+};
+
+// Threads come and go rarely compared to blocks, so the free list takes a
+// lock.
+inline BiasedCount::Owner* BiasedCount::new_owner() {
+  FreeOwners& owners = free_owners();
+  std::lock_guard<std::mutex> lock(owners.mutex);
+  if (Owner* owner = owners.head) {
+    owners.head = owner->next_free;
+    owner->queue.store(nullptr, std::memory_order_relaxed);
+    owner->references.store(1, std::memory_order_relaxed);
+    return owner;
+  }
+  ++owners.allocated;
+  return new Owner();
+}
+
+inline void BiasedCount::release_owner(Owner* owner) {
+  if (owner->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    FreeOwners& owners = free_owners();
+    std::lock_guard<std::mutex> lock(owners.mutex);
+    owner->next_free = owners.head;
+    owners.head = owner;
+  }
+}
+
+// Returns the calling thread's record with a reference for the new block.
+inline BiasedCount::Owner* BiasedCount::attach() {
+  Owner*& owner = current();
+  if (!owner) {
+    // Blocks created while the thread's locals are being destroyed have no
+    // owner to come back to and are merged by the thread that queues them.
+    if (exited()) {
+      closed().references.fetch_add(1, std::memory_order_relaxed);
+      return &closed();
+    }
+    static thread_local Detach detach;
+    owner = new_owner();
+  } else if (owner->queue.load(std::memory_order_relaxed)) {
+    drain();
+  }
+  owner->references.fetch_add(1, std::memory_order_relaxed);
+  return owner;
+}
+
+inline void BiasedCount::release(Block* block) {
+  count_type& count = block->count_shared;
+  if (count.owner == current() && count.biased != 0) {
+    if (--count.biased != 0) {
+      return;
+    }
+    intptr_t word =
+        count.shared.fetch_add(kMerged, std::memory_order_acq_rel) + kMerged;
+    if (word & kQueued) {
+      // Another thread has queued it; it is settled with the queue.
+      drain();
+    } else if (count_of(word) == 0) {
+      block->destroy();
+    }
+    return;
+  }
+  intptr_t word =
+      count.shared.fetch_sub(kOne, std::memory_order_acq_rel) - kOne;
+  if (word & kMerged) {
+    if (word == kMerged) {
+      block->destroy();
+    }
+    return;
+  }
+  // Only one thread queues the block, the first to see the half negative.
+  while (count_of(word) < 0 && !(word & kQueued)) {
+    if (count.shared.compare_exchange_weak(word, word | kQueued,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_relaxed)) {
+      hand_off(block);
+      return;
+    }
+  }
+}
+
+inline void BiasedCount::drain() {
+  if (Owner* owner = current()) {
+    settle_list(owner->queue.exchange(nullptr, std::memory_order_acquire));
+  }
+}
+
+inline void BiasedCount::hand_off(Block* block) {
+  Owner* owner = block->count_shared.owner;
+  Block* head = owner->queue.load(std::memory_order_acquire);
+  do {
+    if (head == closed_mark()) {
+      settle(block);
+      return;
+    }
+    block->count_shared.next_queued = head;
+  } while (!owner->queue.compare_exchange_weak(head, block,
+                                               std::memory_order_release,
+                                               std::memory_order_acquire));
+}
+
+// Merges a queued block on behalf of its owner, unless the owner has already
+// done it, then clears kQueued or frees the block if nothing references it.
+inline void BiasedCount::settle(Block* block) {
+  count_type& count = block->count_shared;
+  intptr_t word = count.shared.load(std::memory_order_acquire);
+  if (!(word & kMerged)) {
+    intptr_t merge = static_cast<intptr_t>(count.biased) * kOne + kMerged;
+    count.biased = 0;
+    word = count.shared.fetch_add(merge, std::memory_order_acq_rel) + merge;
+  }
+  while (true) {
+    if (count_of(word) == 0) {
+      block->destroy();
+      return;
+    }
+    if (count.shared.compare_exchange_weak(word, word & ~kQueued,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+      return;
+    }
+  }
+}
+
+inline void BiasedCount::settle_list(Block* head) {
+  while (head) {
+    Block* next = head->count_shared.next_queued;
+    settle(head);
+    head = next;
+  }
+}
+
+inline BiasedCount::Detach::~Detach() {
+  Owner* owner = current();
+  current() = nullptr;
+  exited() = true;
+  settle_list(owner->queue.exchange(closed_mark(), std::memory_order_acq_rel));
+  release_owner(owner);
+}
+
+// Moves destruction off the releasing thread: the release that drops the
+// shared count of Policy to zero only pushes the block onto a lock-free retire
+// list, and drain() runs the destructors later, on whichever thread calls it
+// (see Reclaimer in reclaimer.hpp). Objects released while destroying
+// retired ones are retired in turn and destroyed by the same drain(), so long
+// chains do not recurse either.
+//
+// Deferred has to be the outermost policy: Deferred<WeakLess<AtomicCount>>,
+// not WeakLess<Deferred<AtomicCount>>.
+template <typename Policy = DefaultCount>
+struct Deferred : Policy {
+  static_assert(!Policy::kReleasesBlock,
+                "Deferred needs a policy that only counts");
+
+  static constexpr bool kReleasesBlock = true;
+
+  using Block = Counter<Deferred>;
+
+  // Both counts carry the link; only the one of count_shared is used.
+  struct count_type {
+    typename Policy::count_type count;
+    Block* next_retired = nullptr;
+
+    count_type(unsigned int initial) : count(initial) {}
+  };
+
+  static void increment(count_type& count) { Policy::increment(count.count); }
+  static size_t decrement(count_type& count) {
+    return Policy::decrement(count.count);
+  }
+  static size_t load(const count_type& count) {
+    return Policy::load(count.count);
+  }
+  static bool increment_if_nonzero(count_type& count) {
+    return Policy::increment_if_nonzero(count.count);
+  }
 
-  virtual void deallocate_block() {}
-  virtual void delete_ptr() {}
-  virtual ~Counter() = default;
+  static void release(Block* block) {
+    if (Policy::decrement(block->count_shared.count) != 0) {
+      return;
+    }
+    std::atomic<Block*>& head = retired();
+    Block* next = head.load(std::memory_order_relaxed);
+    do {
+      block->count_shared.next_retired = next;
+    } while (!head.compare_exchange_weak(next, block,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+  }
+
+  // Destroys everything retired so far and returns the number of blocks.
+  static size_t drain() {
+    size_t destroyed = 0;
+    while (Block* block =
+               retired().exchange(nullptr, std::memory_order_acquire)) {
+      while (block) {
+        Block* next = block->count_shared.next_retired;
+        block->destroy();
+        block = next;
+        ++destroyed;
+      }
+    }
+    return destroyed;
+  }
+
+ private:
+  static std::atomic<Block*>& retired() {
+    static std::atomic<Block*> head{nullptr};
+    return head;
+  }
 };
 
+// Owns an object created outside of the block, released through Deleter.
 template <typename T, typename Deleter = std::default_delete<T>,
-          typename Alloc = std::allocator<T>>
-struct Base : public Counter<T> {
-  Deleter deleter;
-  Alloc alloc;
+          typename Alloc = std::allocator<T>, typename Policy = DefaultCount>
+struct Base : public Counter<Policy>,
+              private EboStorage<Deleter, 0>,
+              private EboStorage<Alloc, 1> {
+  T* object_ptr;
 
   using alloc_traits = std::allocator_traits<Alloc>;
-  using block_alloc =
-      typename alloc_traits::template rebind_alloc<control_block::Base<T, Deleter, Alloc>>;
+  using block_alloc = typename alloc_traits::template rebind_alloc<
+      control_block::Base<T, Deleter, Alloc, Policy>>;
   using block_alloc_traits = typename alloc_traits::template rebind_traits<
-      control_block::Base<T, Deleter, Alloc>>;
-
+      control_block::Base<T, Deleter, Alloc, Policy>>;
 
-  template <typename Y>
-  Base(Y* ptr, Deleter deleter = Deleter(), Alloc alloc = Alloc())
-      : deleter(deleter), alloc(alloc) {
-    Counter<T>::object_ptr = ptr;
+  Base(T* ptr, const Deleter& deleter = Deleter(), const Alloc& alloc = Alloc())
+      : EboStorage<Deleter, 0>(deleter),
+        EboStorage<Alloc, 1>(alloc),
+        object_ptr(ptr) {
+    this->manage = &Base::manage_block;
+    this->template track<T>(sizeof(Base));
   }
 
-  Base(std::nullptr_t, Deleter deleter = Deleter(), Alloc alloc = Alloc())
-      : deleter(deleter), alloc(alloc) {
-    Counter<T>::object_ptr = nullptr;
+  Deleter& deleter() { return EboStorage<Deleter, 0>::get(); }
+  Alloc& alloc() { return EboStorage<Alloc, 1>::get(); }
+
+  static void manage_block(Counter<Policy>* counter, unsigned int action) {
+    Base* block = static_cast<Base*>(counter);
+    if (action & kDeletePtr) {
+      block->deleter()(block->object_ptr);
+    }
+    if (action & kDeallocateBlock) {
+      block_alloc alloc_block = block->alloc();
+      block_alloc_traits::destroy(alloc_block, block);
+      block_alloc_traits::deallocate(alloc_block, block, 1);
+    }
   }
+};
+
+// Holds the object itself, created in the same allocation as the counts.
+template <typename T, typename Alloc = std::allocator<T>,
+          typename Policy = DefaultCount>
+struct Make : public Counter<Policy>, private EboStorage<Alloc, 0> {
+  alignas(T) unsigned char storage[sizeof(T)];
 
-  void deallocate_block() {
-    block_alloc block_alloc = alloc;
-    block_alloc_traits::deallocate(block_alloc, this, 1);
+  using alloc_traits = std::allocator_traits<Alloc>;
+  using object_alloc = typename alloc_traits::template rebind_alloc<T>;
+  using object_alloc_traits = typename alloc_traits::template rebind_traits<T>;
+  using block_alloc = typename alloc_traits::template rebind_alloc<
+      control_block::Make<T, Alloc, Policy>>;
+  using block_alloc_traits = typename alloc_traits::template rebind_traits<
+      control_block::Make<T, Alloc, Policy>>;
+
+  template <typename... Args>
+  Make(const Alloc& alloc, Args &&...args) : EboStorage<Alloc, 0>(alloc) {
+    object_alloc alloc_object = alloc;
+    object_alloc_traits::construct(alloc_object, object_ptr(),
+                                   std::forward<Args>(args)...);
+    this->manage = &Make::manage_block;
+    this->template track<T>(sizeof(Make));
   }
 
-  void delete_ptr() { deleter(Counter<T>::object_ptr); }
+  T* object_ptr() { return reinterpret_cast<T*>(storage); }
+  Alloc& alloc() { return EboStorage<Alloc, 0>::get(); }
 
-  ~Base() = default;
+  static void manage_block(Counter<Policy>* counter, unsigned int action) {
+    Make* block = static_cast<Make*>(counter);
+    if (action & kDeletePtr) {
+      object_alloc alloc_object = block->alloc();
+      object_alloc_traits::destroy(alloc_object, block->object_ptr());
+    }
+    if (action & kDeallocateBlock) {
+      block_alloc alloc_block = block->alloc();
+      block_alloc_traits::destroy(alloc_block, block);
+      block_alloc_traits::deallocate(alloc_block, block, 1);
+    }
+  }
+};
+
+template <size_t Align>
+struct alignas(Align) Chunk {
+  unsigned char bytes[Align];
 };
 
-template <typename T, typename Alloc = std::allocator<T>>
-struct Make : Counter<T> {
-  T object;
-  Alloc alloc;
+enum class ArrayInit { kValue, kFill, kDefault };
+
+// Header and elements of MakeShared<T[]>(n) in one allocation: the elements
+// start at the first suitably aligned offset after the header.
+template <typename T, typename Alloc = std::allocator<T>,
+          typename Policy = DefaultCount>
+struct MakeArray : public Counter<Policy>, private EboStorage<Alloc, 0> {
+  size_t count;
+
+  static constexpr size_t kAlign = alignof(T) > alignof(std::max_align_t)
+                                       ? alignof(T)
+                                       : alignof(std::max_align_t);
+  using chunk = Chunk<kAlign>;
   using alloc_traits = std::allocator_traits<Alloc>;
-  using block_alloc =
-      typename alloc_traits::template rebind_alloc<control_block::Make<T, Alloc>>;
-  using block_alloc_traits =
-      typename alloc_traits::template rebind_traits<control_block::Make<T, Alloc>>;
+  using object_alloc = typename alloc_traits::template rebind_alloc<T>;
+  using object_alloc_traits = typename alloc_traits::template rebind_traits<T>;
+  using chunk_alloc = typename alloc_traits::template rebind_alloc<chunk>;
+  using chunk_alloc_traits =
+      typename alloc_traits::template rebind_traits<chunk>;
 
-  template <typename... Args>
-  Make(Args &&...args) : object(std::forward<Args>(args)...) {
-    alloc = Alloc();
-    Counter<T>::object_ptr = &object;
-    ++Counter<T>::count_shared;
+  MakeArray(const Alloc& alloc, size_t count)
+      : EboStorage<Alloc, 0>(alloc), count(count) {
+    this->manage = &MakeArray::manage_block;
+    this->template track<T>(chunks(count) * sizeof(chunk));
+  }
+
+  static size_t elements_offset() {
+    return (sizeof(MakeArray) + alignof(T) - 1) / alignof(T) * alignof(T);
+  }
+
+  // Largest count whose block size fits in size_t.
+  static size_t max_count() {
+    return (static_cast<size_t>(-1) - elements_offset() - kAlign) / sizeof(T);
   }
 
-  void deallocate_block() {
-    block_alloc block_al = alloc;
-    block_alloc_traits::deallocate(block_al, this, 1);
+  static size_t chunks(size_t count) {
+    return (elements_offset() + count * sizeof(T) + kAlign - 1) / kAlign;
   }
 
-  void delete_ptr() { alloc_traits::destroy(alloc, Counter<T>::object_ptr); }
+  T* elements() {
+    return reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(this) +
+                                elements_offset());
+  }
+
+  Alloc& alloc() { return EboStorage<Alloc, 0>::get(); }
+
+  static MakeArray* create(const Alloc& alloc, size_t count, ArrayInit init,
+                           const T* value = nullptr) {
+    if (count > max_count()) {
+      throw std::bad_array_new_length();
+    }
+    chunk_alloc alloc_chunk = alloc;
+    chunk* memory = chunk_alloc_traits::allocate(alloc_chunk, chunks(count));
+    MakeArray* block = ::new (static_cast<void*>(memory))
+        MakeArray(alloc, count);
+    object_alloc alloc_object = alloc;
+    T* elements = block->elements();
+    size_t constructed = 0;
+    try {
+      for (; constructed < count; ++constructed) {
+        if (init == ArrayInit::kDefault) {
+          ::new (static_cast<void*>(elements + constructed)) T;
+        } else if (init == ArrayInit::kFill) {
+          object_alloc_traits::construct(alloc_object, elements + constructed,
+                                         *value);
+        } else {
+          object_alloc_traits::construct(alloc_object, elements + constructed);
+        }
+      }
+    } catch (...) {
+      while (constructed > 0) {
+        object_alloc_traits::destroy(alloc_object, elements + --constructed);
+      }
+      block->~MakeArray();
+      chunk_alloc_traits::deallocate(alloc_chunk, memory, chunks(count));
+      throw;
+    }
+    return block;
+  }
+
+  static void manage_block(Counter<Policy>* counter, unsigned int action) {
+    MakeArray* block = static_cast<MakeArray*>(counter);
+    if (action & kDeletePtr) {
+      object_alloc alloc_object = block->alloc();
+      for (size_t i = block->count; i > 0; --i) {
+        object_alloc_traits::destroy(alloc_object, block->elements() + i - 1);
+      }
+    }
+    if (action & kDeallocateBlock) {
+      chunk_alloc alloc_chunk = block->alloc();
+      size_t count = block->count;
+      block->~MakeArray();
+      chunk_alloc_traits::deallocate(alloc_chunk,
+                                     reinterpret_cast<chunk*>(block),
+                                     chunks(count));
+    }
+  }
 };
 }; // namespace control_block
 
-template <typename T>
+template <typename T, typename Policy = control_block::DefaultCount>
+class SharedPtr;
+
+template <typename T, typename Policy = control_block::DefaultCount>
+class WeakPtr;
+
+template <typename T, typename Policy>
+class AtomicSharedPtr;
+
+template <typename T, typename Policy = control_block::DefaultCount>
+class EnableSharedFromThis;
+
+template <typename T, typename Policy = control_block::DefaultCount>
+class Borrowed;
+
+template <typename U, typename Policy = control_block::DefaultCount,
+          typename... Args>
+SharedPtr<U, Policy> MakeShared(Args &&...args);
+
+template <typename U, typename Policy = control_block::DefaultCount,
+          typename Alloc, typename... Args>
+SharedPtr<U, Policy> AllocateShared(const Alloc &alloc, Args &&...args);
+
+template <typename U, typename Policy = control_block::DefaultCount>
+SharedPtr<U, Policy> MakeSharedForOverwrite(size_t count);
+
+template <typename U, typename Policy = control_block::DefaultCount,
+          typename Alloc>
+SharedPtr<U, Policy> AllocateSharedForOverwrite(const Alloc &alloc,
+                                                size_t count);
+
+template <typename T, typename Policy>
 class SharedPtr {
+ public:
+  using element_type = std::remove_extent_t<T>;
+
  private:
-  T* ptr_;
-  control_block::Counter<T>* control_block_;
+  element_type* ptr_ = nullptr;
+  control_block::Counter<Policy>* control_block_ = nullptr;
+
+  struct AdoptBlock {};
+
+  // Takes over a reference already counted in the block.
+  SharedPtr(AdoptBlock, control_block::Counter<Policy>* control_block,
+            element_type* ptr)
+      : ptr_(ptr), control_block_(control_block) {}
 
-  template <typename U, typename... Args>
-  friend SharedPtr<U> MakeShared(Args &&...args);
+  template <typename Y, typename Deleter, typename Alloc>
+  void create_block(Y* ptr, const Deleter& deleter, const Alloc& alloc) {
+    using block = control_block::Base<Y, Deleter, Alloc, Policy>;
+    using block_alloc_traits = typename block::block_alloc_traits;
 
-  template <typename U, typename Alloc>
-  SharedPtr(control_block::Make<U, Alloc> *control_block) {
-    control_block_ = control_block;
-    ptr_ = control_block_->object_ptr;
+    typename block::block_alloc alloc_block = alloc;
+    try {
+      block* new_block = block_alloc_traits::allocate(alloc_block, 1);
+      block_alloc_traits::construct(alloc_block, new_block, ptr, deleter,
+                                    alloc);
+      control_block_ = new_block;
+      ptr_ = ptr;
+    } catch (...) {
+      Deleter release = deleter;
+      release(ptr);
+      throw;
+    }
+    if constexpr (!std::is_array<T>::value) {
+      link_weak_this(ptr);
+    }
   }
 
-  template <typename U> friend class WeakPtr;
+  // Points the weak_this_ of an EnableSharedFromThis object at the control
+  // block that has just started owning it.
+  template <typename X>
+  void link_weak_this(const EnableSharedFromThis<X, Policy>* base) {
+    if (base && !base->weak_this_.control_block_) {
+      WeakPtr<X, Policy>& weak_this = base->weak_this_;
+      weak_this.ptr_ = const_cast<X*>(static_cast<const X*>(base));
+      weak_this.control_block_ = control_block_;
+      control_block_->add_weak();
+    }
+  }
 
-  template <typename U, typename Alloc, typename... Args>
-  friend SharedPtr<U> AllocateShared(const Alloc &alloc, Args &&...args);
+  void link_weak_this(...) {}
 
-  template <typename Y> friend class SharedPtr;
+  template <typename U, typename P> friend class WeakPtr;
+
+  template <typename Alloc>
+  static SharedPtr allocate_array(const Alloc& alloc, size_t count,
+                                  control_block::ArrayInit init,
+                                  const element_type* value = nullptr) {
+    using block = control_block::MakeArray<element_type, Alloc, Policy>;
+    block* new_block = block::create(alloc, count, init, value);
+    return SharedPtr(AdoptBlock(), new_block, new_block->elements());
+  }
+
+  template <typename Alloc>
+  static SharedPtr make_array(const Alloc& alloc, size_t count) {
+    return allocate_array(alloc, count, control_block::ArrayInit::kValue);
+  }
+
+  template <typename Alloc, typename Value>
+  static SharedPtr make_array(const Alloc& alloc, size_t count,
+                              const Value& value) {
+    const element_type& element = value;
+    return allocate_array(alloc, count, control_block::ArrayInit::kFill,
+                          &element);
+  }
+
+  template <typename U, typename P, typename Alloc, typename... Args>
+  friend SharedPtr<U, P> AllocateShared(const Alloc &alloc, Args &&...args);
+
+  template <typename U, typename P, typename Alloc>
+  friend SharedPtr<U, P> AllocateSharedForOverwrite(const Alloc &alloc,
+                                                    size_t count);
+
+  template <typename Y, typename P> friend class SharedPtr;
+
+  template <typename U, typename P> friend class AtomicSharedPtr;
+
+  template <typename U, typename P> friend class EnableSharedFromThis;
+
+  template <typename U, typename P> friend class Borrowed;
 
  public:
   SharedPtr() : ptr_(nullptr) {}
@@ -107,182 +855,463 @@ class SharedPtr {
 
   template <typename Y>
   SharedPtr(Y* ptr) {
-    using alloc_traits = std::allocator_traits<std::allocator<T>>;
-    using block_alloc = typename alloc_traits::template rebind_alloc<
-        control_block::Base<T, std::default_delete<T>, std::allocator<T>>>;
-    using block_alloc_traits = typename alloc_traits::template rebind_traits<
-        control_block::Base<T, std::default_delete<T>, std::allocator<T>>>;
+    using deleter = std::conditional_t<std::is_array<T>::value,
+                                       std::default_delete<Y[]>,
+                                       std::default_delete<Y>>;
+    create_block(ptr, deleter(), std::allocator<Y>());
+  }
+
+  template <typename Y, typename Deleter>
+  SharedPtr(Y* ptr, const Deleter& deleter) {
+    create_block(ptr, deleter, std::allocator<Y>());
+  }
 
-    block_alloc alloc;
-    control_block_ = block_alloc_traits::allocate(alloc, 1);
-    block_alloc_traits::construct(
-        alloc, static_cast<control_block::Base<T>*>(control_block_), ptr);
-    ptr_ = control_block_->object_ptr;
-    ++control_block_->count_shared;
+  template <typename Y, typename Deleter, typename Alloc>
+  SharedPtr(Y* ptr, const Deleter& deleter, const Alloc& alloc) {
+    create_block(ptr, deleter, alloc);
+  }
+
+  // Shares the block of a weak reference; throws std::bad_weak_ptr if the
+  // object is already gone.
+  explicit SharedPtr(const WeakPtr<T, Policy>& weak)
+      : ptr_(weak.ptr_), control_block_(weak.control_block_) {
+    if (!control_block_ || !control_block_->promote()) {
+      throw std::bad_weak_ptr();
+    }
   }
 
   ~SharedPtr() {
-    if (!ptr_) {
-      return;
+    if (control_block_) {
+      control_block_->release_shared();
     }
-    if (control_block_->count_shared) {
-      --control_block_->count_shared;
+  }
+
+  template <typename Y>
+  SharedPtr(const SharedPtr<Y, Policy>& other)
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    if (control_block_) {
+      control_block_->add_shared();
     }
-    if (!control_block_->count_shared) {
-      control_block_->delete_ptr();
-      if (!control_block_->count_weak) {
-        control_block_->deallocate_block();
-      }
+  }
+
+  SharedPtr(const SharedPtr& other)
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    if (control_block_) {
+      control_block_->add_shared();
     }
   }
 
+  SharedPtr(SharedPtr&& other)
+      : ptr_(std::exchange(other.ptr_, nullptr)),
+        control_block_(std::exchange(other.control_block_, nullptr)) {}
+
   template <typename Y>
-  SharedPtr(const SharedPtr<Y>& other)
-      : control_block_(
-            reinterpret_cast<control_block::Counter<T>* >(other.control_block_)),
-        ptr_(other.ptr_) {
-    ++control_block_->count_shared;
-  }
+  SharedPtr(SharedPtr<Y, Policy>&& other)
+      : ptr_(std::exchange(other.ptr_, nullptr)),
+        control_block_(std::exchange(other.control_block_, nullptr)) {}
 
-  SharedPtr(const SharedPtr<T>& other)
-      : control_block_(other.control_block_), ptr_(other.ptr_) {
-    ++control_block_->count_shared;
+  // Aliasing constructors: share ownership with `owner` but point to `ptr`,
+  // usually a member or base of the owned object. No block is allocated.
+  template <typename Y>
+  SharedPtr(const SharedPtr<Y, Policy>& owner, element_type* ptr)
+      : ptr_(ptr), control_block_(owner.control_block_) {
+    if (control_block_) {
+      control_block_->add_shared();
+    }
   }
 
-  SharedPtr(SharedPtr<T>&& other)
-      : control_block_(std::move(other.control_block_)),
-        ptr_(std::move(other.ptr_)) {
-    other.control_block_ = nullptr;
-    other.ptr_ = nullptr;
+  template <typename Y>
+  SharedPtr(SharedPtr<Y, Policy>&& owner, element_type* ptr)
+      : ptr_(ptr),
+        control_block_(std::exchange(owner.control_block_, nullptr)) {
+    owner.ptr_ = nullptr;
   }
 
-  template <typename Y> SharedPtr<T>& operator=(const SharedPtr<Y>& other) {
-    SharedPtr<T> dop(other);
+  template <typename Y>
+  SharedPtr& operator=(const SharedPtr<Y, Policy>& other) {
+    SharedPtr dop(other);
     std::swap(control_block_, dop.control_block_);
     std::swap(ptr_, dop.ptr_);
     return *this;
   }
 
-  SharedPtr<T>& operator=(const SharedPtr<T>& other) {
-    SharedPtr<T> dop(other);
+  SharedPtr& operator=(const SharedPtr& other) {
+    SharedPtr dop(other);
     std::swap(control_block_, dop.control_block_);
     std::swap(ptr_, dop.ptr_);
     return *this;
   }
 
-  SharedPtr<T>& operator=(SharedPtr<T>&& other) {
-    SharedPtr<T> dop(std::move(other));
+  SharedPtr& operator=(SharedPtr&& other) {
+    SharedPtr dop(std::move(other));
     std::swap(control_block_, dop.control_block_);
     std::swap(ptr_, dop.ptr_);
     return *this;
   }
 
-  template <typename Y, typename Deleter>
-  SharedPtr(Y* ptr, const Deleter& deleter) {
-    using alloc_traits = std::allocator_traits<std::allocator<T>>;
-    using block_alloc = typename alloc_traits::template rebind_alloc<
-        control_block::Base<T, Deleter, std::allocator<T>>>;
-    using block_alloc_traits = typename alloc_traits::template rebind_traits<
-        control_block::Base<T, Deleter, std::allocator<T>>>;
+  size_t use_count() const {
+    if (!control_block_) {
+      return 0;
+    }
+    return Policy::load(control_block_->count_shared);
+  }
+
+  element_type* get() const { return ptr_; }
 
-    block_alloc alloc;
-    control_block_ = block_alloc_traits::allocate(alloc, 1);
-    block_alloc_traits::construct(
-        alloc, static_cast<control_block::Base<T, Deleter>*>(control_block_),
-        ptr, deleter);
-    ptr_ = control_block_->object_ptr;
-    ++control_block_->count_shared;
+  std::add_lvalue_reference_t<element_type> operator*() const {
+    return *ptr_;
   }
 
-  template <typename Y, typename Deleter, typename Alloc>
-  SharedPtr(Y* ptr, const Deleter& deleter, const Alloc& alloc) {
-    using alloc_traits = std::allocator_traits<Alloc>;
-    using block_alloc = typename alloc_traits::template rebind_alloc<
-        control_block::Base<T, Deleter, Alloc>>;
-    using block_alloc_traits = typename alloc_traits::template rebind_traits<
-        control_block::Base<T, Deleter, Alloc>>;
-
-    block_alloc alloc_block = alloc;
-    control_block_ = block_alloc_traits::allocate(alloc_block, 1);
-    block_alloc_traits::construct(
-        alloc_block,
-        static_cast<control_block::Base<T, Deleter, Alloc>*>(control_block_),
-        ptr, deleter, alloc_block);
-    ptr_ = control_block_->object_ptr;
-    ++control_block_->count_shared;
+  element_type* operator->() const { return ptr_; }
+
+  std::add_lvalue_reference_t<element_type> operator[](
+      std::ptrdiff_t index) const {
+    return ptr_[index];
+  }
+
+  void reset() {
+    if (control_block_) {
+      control_block_->release_shared();
+    }
+    ptr_ = nullptr;
+    control_block_ = nullptr;
+  }
+};
+
+template <typename T, typename Policy>
+class WeakPtr {
+ private:
+  std::remove_extent_t<T>* ptr_;
+  control_block::Counter<Policy>* control_block_;
+
+  template <typename U, typename P> friend class SharedPtr;
+
+  template <typename U, typename P> friend class WeakPtr;
+
+ public:
+  WeakPtr() : ptr_(nullptr), control_block_(nullptr) {
+    static_assert(Policy::kSupportsWeak,
+                  "the counting policy has no weak count");
+  }
+
+  template <typename Y>
+  WeakPtr(const SharedPtr<Y, Policy>& ptr)
+      : ptr_(ptr.ptr_), control_block_(ptr.control_block_) {
+    static_assert(Policy::kSupportsWeak,
+                  "the counting policy has no weak count");
+    if (control_block_) {
+      control_block_->add_weak();
+    }
+  }
+
+  WeakPtr(const WeakPtr& other)
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    if (control_block_) {
+      control_block_->add_weak();
+    }
+  }
+
+  template <typename Y>
+  WeakPtr(const WeakPtr<Y, Policy>& other)
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    if (control_block_) {
+      control_block_->add_weak();
+    }
+  }
+
+  WeakPtr(WeakPtr&& other)
+      : ptr_(std::exchange(other.ptr_, nullptr)),
+        control_block_(std::exchange(other.control_block_, nullptr)) {}
+
+  ~WeakPtr() {
+    if (control_block_) {
+      control_block_->release_weak();
+    }
+  }
+
+  WeakPtr& operator=(const WeakPtr& other) {
+    WeakPtr dop(other);
+    swap(dop);
+    return *this;
+  }
+
+  WeakPtr& operator=(WeakPtr&& other) {
+    WeakPtr dop(std::move(other));
+    swap(dop);
+    return *this;
+  }
+
+  template <typename Y>
+  WeakPtr& operator=(const SharedPtr<Y, Policy>& ptr) {
+    WeakPtr dop(ptr);
+    swap(dop);
+    return *this;
+  }
+
+  void swap(WeakPtr& other) {
+    std::swap(ptr_, other.ptr_);
+    std::swap(control_block_, other.control_block_);
+  }
+
+  void reset() {
+    WeakPtr dop;
+    swap(dop);
   }
 
   size_t use_count() const {
-    if (!ptr_) {
+    if (!control_block_) {
       return 0;
     }
-    return control_block_->count_shared;
+    return Policy::load(control_block_->count_shared);
   }
 
-  T* get() const { return ptr_; }
+  bool expired() const { return use_count() == 0; }
 
-  T& operator*() const { return *ptr_; }
+  // Takes a new shared reference on the existing block only while the count
+  // is non-zero, so a dying object is never resurrected and nothing is
+  // allocated.
+  SharedPtr<T, Policy> lock() const {
+    if (control_block_ && control_block_->promote()) {
+      return SharedPtr<T, Policy>(typename SharedPtr<T, Policy>::AdoptBlock(),
+                                  control_block_, ptr_);
+    }
+    return SharedPtr<T, Policy>();
+  }
+};
 
-  T* operator->() const { return ptr_; }
+// Non-owning view of an object owned by SharedPtrs, for passing it down a
+// call chain without touching the counts. Functions take Borrowed<T> by
+// value and callers pass their SharedPtr; the caller keeps that SharedPtr
+// alive while the call runs, and a callee that has to keep the object calls
+// retain().
+//
+// In release builds Borrowed is two trivially copied pointers. Debug builds
+// hold a weak reference where the policy has one, so that the block stays
+// readable, and assert on every access that the object is still alive;
+// weak-less policies (WeakLess, BiasedCount) are not checked.
+template <typename T, typename Policy>
+class Borrowed {
+ public:
+  using element_type = std::remove_extent_t<T>;
 
-  void reset() {
-    if (!ptr_) {
-      return;
+ private:
+  element_type* ptr_ = nullptr;
+  control_block::Counter<Policy>* control_block_ = nullptr;
+
+  template <typename U, typename P> friend class Borrowed;
+
+  // Reads the count only where hold() keeps the block alive: under a
+  // weak-less policy the last owner frees it, and reading it afterwards
+  // would be a use-after-free of its own, so there is nothing to check.
+  void check() const {
+#ifndef NDEBUG
+    if constexpr (Policy::kSupportsWeak) {
+      assert((!control_block_ ||
+              Policy::load(control_block_->count_shared) != 0) &&
+             "Borrowed used after the last SharedPtr owning the object");
     }
-    if (control_block_->count_shared) {
-      --control_block_->count_shared;
+#endif
+  }
+
+  void hold() {
+#ifndef NDEBUG
+    if constexpr (Policy::kSupportsWeak) {
+      if (control_block_) {
+        control_block_->add_weak();
+      }
     }
-    if (!control_block_->count_shared) {
-      control_block_->delete_ptr();
-      if (!control_block_->count_weak) {
-        control_block_->deallocate_block();
+#endif
+  }
+
+ public:
+  Borrowed() {}
+  Borrowed(std::nullptr_t) {}
+
+  template <typename Y>
+  Borrowed(const SharedPtr<Y, Policy>& owner)
+      : ptr_(owner.ptr_), control_block_(owner.control_block_) {
+    hold();
+  }
+
+  template <typename Y>
+  Borrowed(const Borrowed<Y, Policy>& other)
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    hold();
+  }
+
+#ifdef NDEBUG
+  Borrowed(const Borrowed&) = default;
+  Borrowed& operator=(const Borrowed&) = default;
+  ~Borrowed() = default;
+#else
+  Borrowed(const Borrowed& other)
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    hold();
+  }
+
+  Borrowed& operator=(const Borrowed& other) {
+    Borrowed dop(other);
+    std::swap(ptr_, dop.ptr_);
+    std::swap(control_block_, dop.control_block_);
+    return *this;
+  }
+
+  ~Borrowed() {
+    if constexpr (Policy::kSupportsWeak) {
+      if (control_block_) {
+        control_block_->release_weak();
       }
     }
-    ptr_ = nullptr;
   }
+#endif
+
+  // A new owner of the object, for callees that keep it past the call.
+  SharedPtr<T, Policy> retain() const {
+    check();
+    if (!control_block_) {
+      return SharedPtr<T, Policy>();
+    }
+    control_block_->add_shared();
+    return SharedPtr<T, Policy>(typename SharedPtr<T, Policy>::AdoptBlock(),
+                                control_block_, ptr_);
+  }
+
+  element_type* get() const {
+    check();
+    return ptr_;
+  }
+
+  std::add_lvalue_reference_t<element_type> operator*() const {
+    return *get();
+  }
+
+  element_type* operator->() const { return get(); }
 };
 
-template <typename T>
-class WeakPtr {
+// Lets an object owned by SharedPtr hand out more owners of itself. The
+// link is made by the SharedPtr constructors, MakeShared and AllocateShared,
+// and reuses the object's existing control block.
+template <typename T, typename Policy>
+class EnableSharedFromThis {
  private:
-  T* ptr_;
-  control_block::Counter<T>* control_block_;
+  mutable WeakPtr<T, Policy> weak_this_;
 
- public:
-  WeakPtr(const SharedPtr<T>& ptr)
-      : control_block_(ptr.control_block_), ptr_(ptr.ptr_) {
-    ++control_block_->count_weak;
+  template <typename U, typename P> friend class SharedPtr;
+
+ protected:
+  EnableSharedFromThis() {}
+  EnableSharedFromThis(const EnableSharedFromThis&) {}
+  EnableSharedFromThis& operator=(const EnableSharedFromThis&) {
+    return *this;
   }
+  ~EnableSharedFromThis() = default;
 
-  ~WeakPtr() {
-    --control_block_->count_weak;
-    if (!control_block_->count_weak && !control_block_->count_shared) {
-      control_block_->deallocate_block();
-    }
+ public:
+  // Throws std::bad_weak_ptr if the object is not owned by a SharedPtr.
+  SharedPtr<T, Policy> shared_from_this() {
+    return SharedPtr<T, Policy>(weak_this_);
   }
 
-  bool expired() const { return control_block_->count_shared == 0; }
+  SharedPtr<const T, Policy> shared_from_this() const {
+    SharedPtr<T, Policy> self(weak_this_);
+    return SharedPtr<const T, Policy>(std::move(self));
+  }
 
-  SharedPtr<T> lock() const { return SharedPtr<T>(ptr_); }
+  WeakPtr<T, Policy> weak_from_this() const { return weak_this_; }
 };
 
-template <typename U, typename... Args>
-SharedPtr<U> MakeShared(Args &&...args) {
-  auto control_block =
-      new control_block::Make<U>(std::forward<Args...>(args)...);
-  return SharedPtr<U>(control_block);
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> StaticPointerCast(const SharedPtr<U, Policy>& ptr) {
+  return SharedPtr<T, Policy>(ptr, static_cast<T*>(ptr.get()));
 }
 
-template <typename U, typename Alloc, typename... Args>
-SharedPtr<U> AllocateShared(const Alloc &alloc, Args &&...args) {
-  using alloc_traits = std::allocator_traits<Alloc>;
-  using block_alloc =
-      typename alloc_traits::template rebind_alloc<control_block::Make<U, Alloc>>;
-  using block_alloc_traits =
-      typename alloc_traits::template rebind_traits<control_block::Make<U, Alloc>>;
-
-  block_alloc alloc_new = alloc;
-  auto control_block = block_alloc_traits::allocate(alloc_new, 1);
-  block_alloc_traits::construct(alloc_new, control_block, std::forward<Args...>(args)...);
-  return SharedPtr<U>(control_block);
-}
\ No newline at end of file
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> StaticPointerCast(SharedPtr<U, Policy>&& ptr) {
+  T* cast = static_cast<T*>(ptr.get());
+  return SharedPtr<T, Policy>(std::move(ptr), cast);
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> DynamicPointerCast(const SharedPtr<U, Policy>& ptr) {
+  if (T* cast = dynamic_cast<T*>(ptr.get())) {
+    return SharedPtr<T, Policy>(ptr, cast);
+  }
+  return SharedPtr<T, Policy>();
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> DynamicPointerCast(SharedPtr<U, Policy>&& ptr) {
+  if (T* cast = dynamic_cast<T*>(ptr.get())) {
+    return SharedPtr<T, Policy>(std::move(ptr), cast);
+  }
+  return SharedPtr<T, Policy>();
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ConstPointerCast(const SharedPtr<U, Policy>& ptr) {
+  return SharedPtr<T, Policy>(ptr, const_cast<T*>(ptr.get()));
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ConstPointerCast(SharedPtr<U, Policy>&& ptr) {
+  T* cast = const_cast<T*>(ptr.get());
+  return SharedPtr<T, Policy>(std::move(ptr), cast);
+}
+
+// Control blocks of MakeShared come from the size-class pool with per-thread
+// caches; AllocateShared uses the allocator it is given.
+//
+// For U = T[] both take the element count and optionally a value to copy
+// into every element; the header and the elements share one allocation.
+template <typename U, typename Policy, typename... Args>
+SharedPtr<U, Policy> MakeShared(Args &&...args) {
+  return AllocateShared<U, Policy>(
+      pool::PoolAllocator<std::remove_extent_t<U>>(),
+      std::forward<Args>(args)...);
+}
+
+template <typename U, typename Policy, typename Alloc, typename... Args>
+SharedPtr<U, Policy> AllocateShared(const Alloc &alloc, Args &&...args) {
+  if constexpr (std::is_array<U>::value) {
+    static_assert(std::extent<U>::value == 0,
+                  "only arrays of unknown bound are supported");
+    static_assert(sizeof...(Args) == 1 || sizeof...(Args) == 2,
+                  "arrays take a count and an optional initial value");
+    return SharedPtr<U, Policy>::make_array(alloc,
+                                            std::forward<Args>(args)...);
+  } else {
+    using block = control_block::Make<U, Alloc, Policy>;
+    using block_alloc_traits = typename block::block_alloc_traits;
+
+    typename block::block_alloc alloc_new = alloc;
+    block* control_block = block_alloc_traits::allocate(alloc_new, 1);
+    try {
+      block_alloc_traits::construct(alloc_new, control_block, alloc,
+                                    std::forward<Args>(args)...);
+    } catch (...) {
+      block_alloc_traits::deallocate(alloc_new, control_block, 1);
+      throw;
+    }
+    SharedPtr<U, Policy> result(typename SharedPtr<U, Policy>::AdoptBlock(),
+                                control_block, control_block->object_ptr());
+    result.link_weak_this(result.ptr_);
+    return result;
+  }
+}
+
+// Default-initialises the elements of U = T[], leaving trivial types such as
+// large byte buffers uninitialised.
+template <typename U, typename Policy>
+SharedPtr<U, Policy> MakeSharedForOverwrite(size_t count) {
+  return AllocateSharedForOverwrite<U, Policy>(
+      pool::PoolAllocator<std::remove_extent_t<U>>(), count);
+}
+
+template <typename U, typename Policy, typename Alloc>
+SharedPtr<U, Policy> AllocateSharedForOverwrite(const Alloc &alloc,
+                                                size_t count) {
+  static_assert(std::is_array<U>::value && std::extent<U>::value == 0,
+                "only arrays of unknown bound are supported");
+  return SharedPtr<U, Policy>::allocate_array(
+      alloc, count, control_block::ArrayInit::kDefault);
+}
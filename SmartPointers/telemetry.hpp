@@ -0,0 +1,210 @@
+/**
+ * @file telemetry.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#ifdef SM_POINTERS_TELEMETRY
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+// Per-type counters of control blocks, compiled in only with
+// SM_POINTERS_TELEMETRY defined; without it the control blocks carry no
+// extra field and the hooks disappear. Blocks are attributed to the type
+// they own (Y of SharedPtr(Y*), U of MakeShared<U>).
+//
+// Event counters are spread over kShards cache lines per type, picked by
+// thread, so that threads touching the same type rarely share a line. Live
+// and peak block counts are exact and kept in one place per type.
+namespace telemetry {
+enum Event : unsigned int {
+  kCreated,
+  kDestroyed,
+  kIncrements,
+  kDecrements,
+  kPromotions,
+  kFailedPromotions,
+  kDestroyNanos,
+  kBlockBytes,
+  kEvents
+};
+
+static constexpr size_t kShards = 16;
+
+inline const char* EventName(unsigned int event) {
+  static const char* names[kEvents] = {
+      "created",    "destroyed",         "increments",
+      "decrements", "promotions",        "failed_promotions",
+      "destroy_ns", "block_bytes"};
+  return names[event];
+}
+
+inline size_t ShardIndex() {
+  static std::atomic<size_t> next{0};
+  static thread_local size_t index =
+      next.fetch_add(1, std::memory_order_relaxed) % kShards;
+  return index;
+}
+
+class Type {
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> values[kEvents] = {};
+  };
+
+  std::string name_;
+  Shard shards_[kShards];
+  std::atomic<int64_t> live_{0};
+  std::atomic<int64_t> peak_{0};
+
+ public:
+  Type(std::string name) : name_(std::move(name)) {}
+
+  void add(Event event, uint64_t value = 1) {
+    shards_[ShardIndex()].values[event].fetch_add(value,
+                                                  std::memory_order_relaxed);
+  }
+
+  void created(size_t bytes) {
+    add(kCreated);
+    add(kBlockBytes, bytes);
+    int64_t live = live_.fetch_add(1, std::memory_order_relaxed) + 1;
+    int64_t peak = peak_.load(std::memory_order_relaxed);
+    while (live > peak &&
+           !peak_.compare_exchange_weak(peak, live,
+                                        std::memory_order_relaxed)) {
+    }
+  }
+
+  void destroyed(uint64_t nanos) {
+    add(kDestroyed);
+    add(kDestroyNanos, nanos);
+    live_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  uint64_t total(unsigned int event) const {
+    uint64_t sum = 0;
+    for (const Shard& shard : shards_) {
+      sum += shard.values[event].load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  const std::string& name() const { return name_; }
+  int64_t live() const { return live_.load(std::memory_order_relaxed); }
+  int64_t peak() const { return peak_.load(std::memory_order_relaxed); }
+};
+
+// Types are registered on first use and kept until exit, so that a report
+// can be printed at any time.
+class Registry {
+ private:
+  std::mutex mutex_;
+  std::vector<Type*> types_;
+
+ public:
+  static Registry& instance() {
+    static Registry* registry = new Registry();
+    return *registry;
+  }
+
+  Type* add(std::string name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    types_.push_back(new Type(std::move(name)));
+    return types_.back();
+  }
+
+  std::vector<const Type*> types() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::vector<const Type*>(types_.begin(), types_.end());
+  }
+};
+
+template <typename T>
+std::string Name() {
+  const char* raw = typeid(T).name();
+#ifdef __GNUG__
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(raw, nullptr, nullptr, &status);
+  if (status == 0) {
+    std::string name(demangled);
+    std::free(demangled);
+    return name;
+  }
+#endif
+  return raw;
+}
+
+template <typename T>
+Type& TypeOf() {
+  static Type* type = Registry::instance().add(Name<T>());
+  return *type;
+}
+
+inline uint64_t NanosSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Types sorted by count traffic, busiest first.
+inline std::vector<const Type*> Busiest() {
+  std::vector<const Type*> types = Registry::instance().types();
+  auto traffic = [](const Type* type) {
+    return type->total(kIncrements) + type->total(kDecrements);
+  };
+  std::stable_sort(types.begin(), types.end(),
+                   [&](const Type* lhs, const Type* rhs) {
+                     return traffic(lhs) > traffic(rhs);
+                   });
+  return types;
+}
+
+inline void Report(std::ostream& out) {
+  out << "type\tlive\tpeak";
+  for (unsigned int event = 0; event < kEvents; ++event) {
+    out << '\t' << EventName(event);
+  }
+  out << '\n';
+  for (const Type* type : Busiest()) {
+    out << type->name() << '\t' << type->live() << '\t' << type->peak();
+    for (unsigned int event = 0; event < kEvents; ++event) {
+      out << '\t' << type->total(event);
+    }
+    out << '\n';
+  }
+}
+
+inline void ReportJson(std::ostream& out) {
+  out << "{\"types\":[";
+  bool first = true;
+  for (const Type* type : Busiest()) {
+    out << (first ? "" : ",") << "{\"name\":\"";
+    for (char symbol : type->name()) {
+      if (symbol == '"' || symbol == '\\') {
+        out << '\\';
+      }
+      out << symbol;
+    }
+    out << "\",\"live\":" << type->live() << ",\"peak\":" << type->peak();
+    for (unsigned int event = 0; event < kEvents; ++event) {
+      out << ",\"" << EventName(event) << "\":" << type->total(event);
+    }
+    out << '}';
+    first = false;
+  }
+  out << "]}\n";
+}
+}; // namespace telemetry
+#endif
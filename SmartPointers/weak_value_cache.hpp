@@ -0,0 +1,132 @@
+/**
+ * @file weak_value_cache.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#include "sm_pointers.hpp"
+
+// Map from keys to objects that are kept alive only by their users. The
+// cache holds WeakPtrs: lookups promote them with WeakPtr::lock, entries of
+// dead objects are dropped when a lookup finds them and by a sweep that
+// runs once a shard has doubled in size since the previous one.
+//
+// Keys are spread over kShards independently locked shards. Sharing the
+// returned pointers across threads needs a thread-safe counting policy.
+template <typename K, typename T, typename Policy = control_block::DefaultCount,
+          typename Hash = std::hash<K>, size_t kShards = 16>
+class WeakValueCache {
+ private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<K, WeakPtr<T, Policy>, Hash> entries;
+    size_t next_sweep = kMinSweep;
+  };
+
+  static constexpr size_t kMinSweep = 16;
+
+  Hash hash_;
+  Shard shards_[kShards];
+
+  Shard& shard_of(const K& key) { return shards_[hash_(key) % kShards]; }
+
+  static size_t sweep(Shard& shard) {
+    size_t removed = 0;
+    for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+      if (it->second.expired()) {
+        it = shard.entries.erase(it);
+        ++removed;
+      } else {
+        ++it;
+      }
+    }
+    shard.next_sweep = std::max(kMinSweep, 2 * shard.entries.size());
+    return removed;
+  }
+
+  // Both expect the shard to be locked.
+  static SharedPtr<T, Policy> find_locked(Shard& shard, const K& key) {
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+      return SharedPtr<T, Policy>();
+    }
+    SharedPtr<T, Policy> value = it->second.lock();
+    if (!value.get()) {
+      shard.entries.erase(it);
+    }
+    return value;
+  }
+
+  static void insert_locked(Shard& shard, const K& key,
+                            const SharedPtr<T, Policy>& value) {
+    shard.entries[key] = value;
+    if (shard.entries.size() >= shard.next_sweep) {
+      sweep(shard);
+    }
+  }
+
+ public:
+  WeakValueCache(const Hash& hash = Hash()) : hash_(hash) {}
+
+  // Returns the live object for `key` or an empty pointer.
+  SharedPtr<T, Policy> find(const K& key) {
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return find_locked(shard, key);
+  }
+
+  // Publishes `value` unless a live object is already cached for `key`;
+  // returns whichever object the cache holds afterwards.
+  SharedPtr<T, Policy> insert(const K& key, SharedPtr<T, Policy> value) {
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    SharedPtr<T, Policy> existing = find_locked(shard, key);
+    if (existing.get()) {
+      return existing;
+    }
+    insert_locked(shard, key, value);
+    return value;
+  }
+
+  // Creates the object with factory() outside the lock on a miss. If two
+  // threads race on the same key, both get the object published first.
+  template <typename Factory>
+  SharedPtr<T, Policy> get_or_create(const K& key, Factory factory) {
+    SharedPtr<T, Policy> existing = find(key);
+    if (existing.get()) {
+      return existing;
+    }
+    return insert(key, factory());
+  }
+
+  void erase(const K& key) {
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.entries.erase(key);
+  }
+
+  // Drops the entries of all dead objects and returns how many were removed.
+  size_t purge() {
+    size_t removed = 0;
+    for (Shard& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      removed += sweep(shard);
+    }
+    return removed;
+  }
+
+  // Number of entries, including dead ones that were not reclaimed yet.
+  size_t size() {
+    size_t total = 0;
+    for (Shard& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      total += shard.entries.size();
+    }
+    return total;
+  }
+};
@@ -0,0 +1,86 @@
+/**
+ * @file atomic_shared_ptr_test.cpp
+ * @author SofiHaku
+ *
+ * Readers load() and read() an AtomicSharedPtr, some holding more Guards
+ * than a hazard record has slots, while writers store, exchange and
+ * compare-exchange it. No reader may see a destroyed value, and once
+ * everything is released every value must have been destroyed.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "SmartPointers/atomic_sm_pointers.hpp"
+#include "test_common.hpp"
+
+const unsigned kAlive = 0x600dcafe;
+
+std::atomic<long> live{0};
+
+struct Value {
+  unsigned magic = kAlive;
+  size_t version;
+
+  explicit Value(size_t new_version) : version(new_version) { ++live; }
+  ~Value() {
+    magic = 0;
+    --live;
+  }
+};
+
+void Stress() {
+  AtomicSharedPtr<Value> slot(MakeShared<Value>(0));
+  std::atomic<bool> done{false};
+  std::vector<std::thread> threads;
+  for (size_t reader = 0; reader < 4; ++reader) {
+    threads.emplace_back([&, reader] {
+      while (!done.load(std::memory_order_relaxed)) {
+        if (reader % 2 == 0) {
+          SharedPtr<Value> value = slot.load();
+          CHECK(value->magic == kAlive);
+          continue;
+        }
+        std::vector<AtomicSharedPtr<Value>::Guard*> guards;
+        for (size_t i = 0; i < hazard::kSlots + 3; ++i) {
+          guards.push_back(new AtomicSharedPtr<Value>::Guard(slot.read()));
+        }
+        std::this_thread::yield();
+        for (auto* guard : guards) {
+          CHECK((*guard)->magic == kAlive);
+          delete guard;
+        }
+      }
+    });
+  }
+  for (size_t writer = 0; writer < 2; ++writer) {
+    threads.emplace_back([&] {
+      for (size_t i = 1; i <= 100000; ++i) {
+        if (i % 3 == 0) {
+          slot.store(MakeShared<Value>(i));
+        } else if (i % 3 == 1) {
+          CHECK(slot.exchange(MakeShared<Value>(i))->magic == kAlive);
+        } else {
+          SharedPtr<Value> expected = slot.load();
+          while (!slot.compare_exchange_strong(expected,
+                                               MakeShared<Value>(i))) {
+          }
+        }
+      }
+    });
+  }
+  threads[4].join();
+  threads[5].join();
+  done.store(true);
+  for (size_t i = 0; i < 4; ++i) {
+    threads[i].join();
+  }
+}
+
+int main() {
+  Stress();
+  hazard::Scan();
+  CHECK(live.load() == 0);
+  return 0;
+}
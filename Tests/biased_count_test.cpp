@@ -0,0 +1,104 @@
+/**
+ * @file biased_count_test.cpp
+ * @author SofiHaku
+ *
+ * Waves of threads create BiasedCount blocks and hand copies to each other
+ * through a mailbox, so references are dropped by owners and non-owners in
+ * any order, blocks are queued back to owners, and blocks outlive the
+ * threads that created them. Every object must be destroyed exactly once,
+ * and Owner records must be recycled rather than allocated per thread.
+ * Meant to be run with -DTEST_SANITIZER=thread and address as well.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "SmartPointers/sm_pointers.hpp"
+#include "test_common.hpp"
+
+using Biased = control_block::BiasedCount;
+
+const size_t kWaves = 20;
+const size_t kThreads = 4;
+const size_t kSteps = 3000;
+
+std::atomic<long> live{0};
+
+struct Counted {
+  Counted() { ++live; }
+  ~Counted() { --live; }
+};
+
+using CountedPointer = SharedPtr<Counted, Biased>;
+
+struct Mailbox {
+  std::mutex mutex;
+  std::vector<CountedPointer> pointers;
+
+  void put(CountedPointer pointer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pointers.push_back(std::move(pointer));
+  }
+
+  CountedPointer take() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pointers.empty()) {
+      return CountedPointer();
+    }
+    CountedPointer pointer = std::move(pointers.back());
+    pointers.pop_back();
+    return pointer;
+  }
+};
+
+void Worker(Mailbox& mailbox, unsigned seed) {
+  std::mt19937 random(seed);
+  std::vector<CountedPointer> kept;
+  for (size_t step = 0; step < kSteps; ++step) {
+    CountedPointer own = MakeShared<Counted, Biased>();
+    if (random() % 2) {
+      mailbox.put(own);
+    }
+    if (random() % 4 == 0) {
+      kept.push_back(own);
+    }
+    CountedPointer other = mailbox.take();
+    if (other.get()) {
+      CountedPointer copy = other;
+      if (random() % 3 == 0) {
+        mailbox.put(std::move(copy));
+      }
+    }
+    if (kept.size() > 16) {
+      kept.erase(kept.begin(), kept.begin() + 8);
+    }
+    if (step % 256 == 0) {
+      Biased::drain();
+    }
+  }
+}
+
+int main() {
+  Mailbox mailbox;
+  for (size_t wave = 0; wave < kWaves; ++wave) {
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kThreads; ++i) {
+      threads.emplace_back(Worker, std::ref(mailbox),
+                           static_cast<unsigned>(wave * kThreads + i));
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    // What is left belongs to threads that have exited.
+    while (mailbox.take().get()) {
+    }
+    CHECK(live.load() == 0);
+  }
+  // The main thread never created a block; each wave needs at most one
+  // record per worker, and records of finished waves are reused.
+  CHECK(Biased::owner_records() <= kThreads);
+  return 0;
+}
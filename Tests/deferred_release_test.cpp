@@ -0,0 +1,101 @@
+/**
+ * @file deferred_release_test.cpp
+ * @author SofiHaku
+ *
+ * Deferred<AtomicCount> under concurrency: threads release shared graphs
+ * and lock weak references while a Reclaimer destroys retired blocks in the
+ * background and a writer republishes an AtomicSharedPtr slot. No object
+ * may be destroyed while referenced, lock() must fail once the last owner
+ * is gone, everything must be destroyed once the reclaimer has stopped, and
+ * a long chain must be destroyed by drain() without recursing.
+ * Meant to be run with -DTEST_SANITIZER=thread and address as well.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "SmartPointers/atomic_sm_pointers.hpp"
+#include "SmartPointers/reclaimer.hpp"
+#include "test_common.hpp"
+
+using Deferred = control_block::Deferred<control_block::AtomicCount>;
+
+const unsigned kAlive = 0x600dcafe;
+
+std::atomic<long> live{0};
+
+struct Node {
+  unsigned magic = kAlive;
+  SharedPtr<Node, Deferred> next;
+
+  Node() { ++live; }
+  ~Node() {
+    CHECK(magic == kAlive);
+    magic = 0;
+    --live;
+  }
+};
+
+using NodePointer = SharedPtr<Node, Deferred>;
+
+NodePointer Chain(size_t length) {
+  NodePointer head;
+  for (size_t i = 0; i < length; ++i) {
+    NodePointer node = MakeShared<Node, Deferred>();
+    node->next = std::move(head);
+    head = std::move(node);
+  }
+  return head;
+}
+
+void ReleaseConcurrently() {
+  Reclaimer<Deferred> reclaimer(std::chrono::microseconds(50));
+  AtomicSharedPtr<Node, Deferred> slot(Chain(10));
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    while (!done.load(std::memory_order_relaxed)) {
+      slot.store(Chain(10));
+      std::this_thread::yield();
+    }
+  });
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (size_t i = 0; i < 2000; ++i) {
+        NodePointer chain = Chain(20);
+        NodePointer copy = chain;
+        WeakPtr<Node, Deferred> weak(chain);
+        CHECK(slot.load()->magic == kAlive);
+        chain.reset();
+        CHECK(weak.lock()->magic == kAlive);
+        copy.reset();
+        CHECK(weak.lock().get() == nullptr);
+        CHECK(weak.expired());
+        if (i % 100 == 0) {
+          reclaimer.wake();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  done.store(true);
+  writer.join();
+}
+
+int main() {
+  ReleaseConcurrently();
+  // The slot's last Holders are retired to the hazard domain, which hands
+  // the values back to Deferred.
+  hazard::Scan();
+  Deferred::drain();
+  CHECK(live.load() == 0);
+
+  NodePointer chain = Chain(1000000);
+  chain.reset();
+  CHECK(Deferred::drain() == 1000000);
+  CHECK(live.load() == 0);
+  return 0;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file deque_iterator_test.cpp
+ * @author SofiHaku
+ *
+ * Deque iterators and contiguous() against indexing, for element sizes
+ * that give buckets of 64, 16 and the minimum of 16 elements, and for
+ * starts at every slot of a bucket: every it + n, it - n and it1 - it2
+ * must land where operator[] says, including distances that are multiples
+ * of the bucket size, which operator-= used to turn into slot kBucket.
+ */
+
+#include <array>
+#include <cstddef>
+
+#include "Deque/deque.hpp"
+#include "test_common.hpp"
+
+template <size_t kBytes>
+struct Element {
+  std::array<size_t, kBytes / sizeof(size_t)> words{};
+  Element() {}
+  Element(size_t key) { words[0] = key; }
+};
+
+template <size_t kBytes>
+void CheckArithmetic(size_t pushed_front) {
+  using Value = Element<kBytes>;
+  Deque<Value> deque;
+  const size_t kSize = 300;
+  for (size_t i = pushed_front; i < kSize; ++i) {
+    deque.push_back(Value(i));
+  }
+  for (size_t i = pushed_front; i-- > 0;) {
+    deque.push_front(Value(i));
+  }
+  auto begin = deque.begin();
+  for (size_t from = 0; from <= kSize; ++from) {
+    auto it = begin + static_cast<std::ptrdiff_t>(from);
+    CHECK(it - begin == static_cast<std::ptrdiff_t>(from));
+    for (size_t to = 0; to <= kSize; ++to) {
+      auto moved = it;
+      if (to >= from) {
+        moved += static_cast<std::ptrdiff_t>(to - from);
+      } else {
+        moved -= static_cast<std::ptrdiff_t>(from - to);
+      }
+      CHECK(moved - begin == static_cast<std::ptrdiff_t>(to));
+      if (to < kSize) {
+        CHECK((*moved).words[0] == to);
+        CHECK(&*moved == &deque[to]);
+      } else {
+        CHECK(moved == deque.end());
+      }
+    }
+  }
+  // contiguous() reports runs that match indexing and tile the deque.
+  for (size_t index = 0; index < kSize;) {
+    size_t length = 0;
+    Value* run = deque.contiguous(index, length);
+    CHECK(length > 0);
+    for (size_t i = 0; i < length && index + i < kSize; ++i) {
+      CHECK(&run[i] == &deque[index + i]);
+    }
+    index += length;
+  }
+}
+
+int main() {
+  for (size_t pushed_front = 0; pushed_front < 70; ++pushed_front) {
+    CheckArithmetic<8>(pushed_front);
+    CheckArithmetic<32>(pushed_front);
+    CheckArithmetic<256>(pushed_front);
+  }
+  return 0;
+}
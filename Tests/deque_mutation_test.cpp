@@ -0,0 +1,201 @@
+/**
+ * @file deque_mutation_test.cpp
+ * @author SofiHaku
+ *
+ * Deque's mutation paths: a random mix of emplace, insert, erase and the
+ * push/pop/emplace operations at both ends on move-only elements, against
+ * std::deque, including the iterators emplace, insert and erase return;
+ * no copies on any of them, and construction in place at either end; and
+ * a throwing constructor in emplace_front that leaves the deque as it was.
+ * Meant to be run with -DTEST_SANITIZER=address as well.
+ */
+
+#include <deque>
+#include <memory>
+#include <random>
+
+#include "Deque/deque.hpp"
+#include "test_common.hpp"
+
+using Owned = std::unique_ptr<int>;
+
+void CheckSame(Deque<Owned>& deque, const std::deque<int>& reference) {
+  CHECK(deque.size() == reference.size());
+  size_t i = 0;
+  for (auto it = deque.begin(); it != deque.end(); ++it, ++i) {
+    CHECK(**it == reference[i]);
+  }
+  CHECK(i == reference.size());
+}
+
+void AgainstStdDeque(unsigned seed) {
+  Deque<Owned> deque;
+  std::deque<int> reference;
+  std::mt19937 random(seed);
+  for (int step = 0; step < 20000; ++step) {
+    // Phases that favour growing and shrinking in turn.
+    bool grow = (step / 1000) % 2 == 0;
+    size_t op = random() % 10;
+    size_t index = random() % (reference.size() + 1);
+    if (op < (grow ? 6u : 3u) || reference.empty()) {
+      switch (random() % 5) {
+        case 0: {
+          auto it = deque.emplace(deque.begin() + index, new int(step));
+          CHECK(it - deque.begin() == static_cast<std::ptrdiff_t>(index));
+          CHECK(**it == step);
+          break;
+        }
+        case 1: {
+          auto it = deque.insert(deque.begin() + index,
+                                 std::make_unique<int>(step));
+          CHECK(it - deque.begin() == static_cast<std::ptrdiff_t>(index));
+          CHECK(**it == step);
+          break;
+        }
+        case 2:
+          deque.emplace_front(new int(step));
+          index = 0;
+          break;
+        case 3:
+          deque.push_back(std::make_unique<int>(step));
+          index = reference.size();
+          break;
+        default:
+          deque.push_front(std::make_unique<int>(step));
+          index = 0;
+          break;
+      }
+      reference.insert(reference.begin() + index, step);
+    } else {
+      index %= reference.size();
+      switch (random() % 3) {
+        case 0: {
+          auto it = deque.erase(deque.begin() + index);
+          reference.erase(reference.begin() + index);
+          CHECK(it - deque.begin() == static_cast<std::ptrdiff_t>(index));
+          if (index < reference.size()) {
+            CHECK(**it == reference[index]);
+          } else {
+            CHECK(it == deque.end());
+          }
+          break;
+        }
+        case 1:
+          deque.pop_front();
+          reference.pop_front();
+          break;
+        default:
+          deque.pop_back();
+          reference.pop_back();
+          break;
+      }
+    }
+    CheckSame(deque, reference);
+  }
+}
+
+struct Counted {
+  static inline size_t constructions = 0;
+  static inline size_t copies = 0;
+  static inline size_t moves = 0;
+
+  int value;
+
+  Counted(int value) : value(value) { ++constructions; }
+  Counted(const Counted& other) : value(other.value) { ++copies; }
+  Counted(Counted&& other) noexcept : value(other.value) { ++moves; }
+  Counted& operator=(const Counted& other) {
+    value = other.value;
+    ++copies;
+    return *this;
+  }
+  Counted& operator=(Counted&& other) noexcept {
+    value = other.value;
+    ++moves;
+    return *this;
+  }
+
+  static void reset() { constructions = copies = moves = 0; }
+};
+
+void NoCopies() {
+  Deque<Counted> deque;
+  for (int i = 0; i < 300; ++i) {
+    deque.emplace_back(i);
+  }
+
+  // At either end the element is constructed in its slot.
+  Counted::reset();
+  deque.emplace_back(1000);
+  deque.emplace_front(-1);
+  deque.emplace(deque.end(), 1001);
+  deque.emplace(deque.begin(), -2);
+  CHECK(Counted::constructions == 4);
+  CHECK(Counted::moves == 0);
+  CHECK(Counted::copies == 0);
+
+  // In the middle and on erase elements are moved, never copied.
+  Counted::reset();
+  for (int i = 0; i < 100; ++i) {
+    deque.emplace(deque.begin() + 7 * i % deque.size(), i);
+    deque.insert(deque.begin() + 13 * i % deque.size(), Counted(i));
+    deque.erase(deque.begin() + 11 * i % deque.size());
+  }
+  CHECK(Counted::copies == 0);
+  CHECK(Counted::moves > 0);
+  CHECK(deque.size() == 404);
+}
+
+struct Fragile {
+  static inline bool fail = false;
+
+  int value;
+
+  Fragile(int value) : value(value) {
+    if (fail) {
+      throw 1;
+    }
+  }
+};
+
+// The start slot steps back before constructing, into a fresh bucket when
+// it was at slot 0; a throw must undo that step.
+void ThrowingEmplaceFront() {
+  for (int count = 0; count < 300; ++count) {
+    Deque<Fragile> deque;
+    for (int i = count; i-- > 0;) {
+      deque.emplace_front(i);
+    }
+    Fragile::fail = true;
+    bool thrown = false;
+    try {
+      deque.emplace_front(-1);
+    } catch (int) {
+      thrown = true;
+    }
+    Fragile::fail = false;
+    CHECK(thrown);
+    CHECK(deque.size() == static_cast<size_t>(count));
+    if (count > 0) {
+      CHECK((*deque.begin()).value == 0);
+      CHECK(&*deque.begin() == &deque[0]);
+    }
+    for (int i = 0; i < count; ++i) {
+      CHECK(deque[i].value == i);
+    }
+    // The deque goes on working from the restored start.
+    deque.emplace_front(-1);
+    CHECK(deque.size() == static_cast<size_t>(count) + 1);
+    CHECK(deque[0].value == -1);
+    CHECK(deque.end() - deque.begin() == count + 1);
+  }
+}
+
+int main() {
+  for (unsigned seed = 0; seed < 3; ++seed) {
+    AgainstStdDeque(seed);
+  }
+  NoCopies();
+  ThrowingEmplaceFront();
+  return 0;
+}
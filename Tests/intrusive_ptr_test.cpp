@@ -0,0 +1,132 @@
+/**
+ * @file intrusive_ptr_test.cpp
+ * @author SofiHaku
+ *
+ * RefCounted objects are created and deleted by the class-level operators:
+ * small objects come from the size-class pool and go back to the class of
+ * their dynamic size, also when deleted through a base with a virtual
+ * destructor, while over-aligned objects and objects larger than
+ * pool::kMaxBlockSize go to the global operators. detach() and
+ * add_ref = false hand a reference over without counting it twice.
+ * Meant to be run with -DTEST_SANITIZER=address, which catches a pool
+ * block handed to the global delete and mismatched sized or aligned pairs.
+ */
+
+#include <cstdint>
+
+#include "SmartPointers/intrusive_ptr.hpp"
+#include "test_common.hpp"
+
+long live = 0;
+
+struct Small : RefCounted<Small> {
+  int value;
+  explicit Small(int value) : value(value) { ++live; }
+  ~Small() { --live; }
+};
+
+struct Shape : RefCounted<Shape> {
+  Shape() { ++live; }
+  virtual ~Shape() { --live; }
+};
+
+// Different size classes than Shape.
+struct Polygon : Shape {
+  char vertices[200] = {};
+};
+
+// Past the pool, though its base is not.
+struct Mesh : Shape {
+  char vertices[pool::kMaxBlockSize * 2] = {};
+};
+
+struct alignas(64) Aligned : RefCounted<Aligned> {
+  char bytes[64] = {};
+  Aligned() { ++live; }
+  ~Aligned() { --live; }
+};
+
+struct Large : RefCounted<Large> {
+  char bytes[pool::kMaxBlockSize + 1] = {};
+  Large() { ++live; }
+  ~Large() { --live; }
+};
+
+// The thread cache hands blocks out last in, first out, so a block freed
+// into the class of `bytes` is the next one that class serves.
+bool ReturnedToPool(const void* ptr, size_t bytes) {
+  void* next = pool::Allocate(bytes);
+  pool::Deallocate(next, bytes);
+  return next == ptr;
+}
+
+void Pooled() {
+  IntrusivePtr<Small> small = MakeIntrusive<Small>(7);
+  const void* address = small.get();
+  CHECK(small->value == 7);
+  CHECK(small.use_count() == 1);
+  small.reset();
+  CHECK(live == 0);
+  CHECK(ReturnedToPool(address, sizeof(Small)));
+
+  // Deleted as a Shape, freed with the size of a Polygon.
+  IntrusivePtr<Shape> polygon = MakeIntrusive<Polygon>();
+  address = polygon.get();
+  polygon.reset();
+  CHECK(live == 0);
+  CHECK(ReturnedToPool(address, sizeof(Polygon)));
+  CHECK(!ReturnedToPool(address, sizeof(Shape)));
+
+  IntrusivePtr<Shape> mesh = MakeIntrusive<Mesh>();
+  CHECK(mesh.use_count() == 1);
+  mesh.reset();
+  CHECK(live == 0);
+}
+
+void Unpooled() {
+  IntrusivePtr<Aligned> aligned = MakeIntrusive<Aligned>();
+  CHECK(reinterpret_cast<uintptr_t>(aligned.get()) % alignof(Aligned) == 0);
+  IntrusivePtr<Aligned> copy = aligned;
+  CHECK(aligned.use_count() == 2);
+  aligned.reset();
+  copy.reset();
+  CHECK(live == 0);
+
+  IntrusivePtr<Large> large = MakeIntrusive<Large>();
+  large->bytes[pool::kMaxBlockSize] = 1;
+  large.reset();
+  CHECK(live == 0);
+}
+
+void Handover() {
+  IntrusivePtr<Small> owner = MakeIntrusive<Small>(1);
+  Small* raw = owner.detach();
+  CHECK(owner.get() == nullptr);
+  CHECK(raw->use_count() == 1);
+
+  IntrusivePtr<Small> shared(raw);
+  CHECK(raw->use_count() == 2);
+  IntrusivePtr<Small> adopted(raw, false);
+  CHECK(raw->use_count() == 2);
+  shared.reset();
+  CHECK(live == 1);
+  adopted.reset();
+  CHECK(live == 0);
+
+  // Rvalue casts hand the reference over the same way.
+  IntrusivePtr<Shape> shape = MakeIntrusive<Polygon>();
+  IntrusivePtr<Polygon> polygon = DynamicPointerCast<Polygon>(std::move(shape));
+  CHECK(shape.get() == nullptr);
+  CHECK(polygon.use_count() == 1);
+  IntrusivePtr<Shape> back = StaticPointerCast<Shape>(std::move(polygon));
+  CHECK(back.use_count() == 1);
+  back.reset();
+  CHECK(live == 0);
+}
+
+int main() {
+  Pooled();
+  Unpooled();
+  Handover();
+  return 0;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file list_test.cpp
+ * @author SofiHaku
+ *
+ * List against std::deque under a random mix of push and pop at both ends:
+ * after every step the size and the elements, walked forward, must match,
+ * and so must the last one reached backwards from end(). The list is
+ * emptied and refilled along the way, and its TrackingAllocator ends with
+ * nothing in use.
+ * Meant to be run with -DTEST_SANITIZER=address as well.
+ */
+
+#include <deque>
+#include <random>
+
+#include "Allocators/tracking_allocator.hpp"
+#include "List/list.hpp"
+#include "test_common.hpp"
+
+using Tracked = TrackingAllocator<int>;
+
+void CheckSame(List<int, Tracked>& list, const std::deque<int>& reference) {
+  CHECK(list.size() == reference.size());
+  CHECK(list.empty() == reference.empty());
+  auto expected = reference.begin();
+  for (auto it = list.begin(); it != list.end(); ++it, ++expected) {
+    CHECK(expected != reference.end());
+    CHECK(*it == *expected);
+  }
+  CHECK(expected == reference.end());
+  if (!reference.empty()) {
+    auto last = list.end();
+    --last;
+    CHECK(*last == reference.back());
+  }
+}
+
+int main() {
+  SharedPtr<AllocationStats> stats = MakeShared<AllocationStats>();
+  {
+    List<int, Tracked> list{Tracked(stats)};
+    std::deque<int> reference;
+    std::mt19937 random(1);
+    for (int step = 0; step < 20000; ++step) {
+      // Phases that favour pushing and popping in turn, so the list keeps
+      // running empty.
+      bool grow = (step / 500) % 2 == 0;
+      size_t op = random() % 8;
+      if (op < (grow ? 3u : 1u)) {
+        list.push_back(step);
+        reference.push_back(step);
+      } else if (op < (grow ? 6u : 2u)) {
+        list.push_front(step);
+        reference.push_front(step);
+      } else if (reference.empty()) {
+        continue;
+      } else if (op % 2 == 0) {
+        list.pop_back();
+        reference.pop_back();
+      } else {
+        list.pop_front();
+        reference.pop_front();
+      }
+      CheckSame(list, reference);
+    }
+    while (!reference.empty()) {
+      list.pop_back();
+      reference.pop_back();
+      CheckSame(list, reference);
+    }
+    list.push_front(1);
+    reference.push_front(1);
+    CheckSame(list, reference);
+    list.pop_front();
+    reference.pop_front();
+    CheckSame(list, reference);
+  }
+  CHECK(stats->allocations() == stats->deallocations());
+  CHECK(stats->bytes_in_use() == 0);
+  return 0;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file make_shared_array_test.cpp
+ * @author SofiHaku
+ *
+ * MakeShared<T[]> with a count whose block size would overflow throws
+ * instead of allocating a short block and constructing past its end.
+ */
+
+#include <cstdint>
+#include <new>
+
+#include "SmartPointers/sm_pointers.hpp"
+#include "test_common.hpp"
+
+template <typename Make>
+bool Throws(Make make) {
+  try {
+    make();
+  } catch (const std::bad_array_new_length&) {
+    return true;
+  }
+  return false;
+}
+
+int main() {
+  size_t huge = SIZE_MAX / sizeof(int) + 2;
+  CHECK(Throws([&] { MakeShared<int[]>(huge); }));
+  CHECK(Throws([&] { MakeShared<int[]>(huge, 7); }));
+  CHECK(Throws([&] { MakeSharedForOverwrite<int[]>(SIZE_MAX / 2); }));
+  CHECK(Throws([&] {
+    AllocateShared<int[]>(std::allocator<int>(), SIZE_MAX / sizeof(int));
+  }));
+
+  SharedPtr<int[]> small = MakeShared<int[]>(5, 7);
+  for (int i = 0; i < 5; ++i) {
+    CHECK(small[i] == 7);
+  }
+  return 0;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file persistent_list_test.cpp
+ * @author SofiHaku
+ *
+ * Dropping long PersistentLists must not recurse through the nodes, neither
+ * on one thread nor when the last two snapshots are dropped on two threads
+ * at once, where either release may turn out to be the last.
+ */
+
+#include <thread>
+
+#include "List/persistent_list.hpp"
+#include "test_common.hpp"
+
+const size_t kLength = 1000000;
+
+template <typename Policy>
+PersistentList<size_t, Policy> Build(size_t length) {
+  PersistentList<size_t, Policy> list;
+  for (size_t i = 0; i < length; ++i) {
+    list.push_front(i);
+  }
+  return list;
+}
+
+void DropOnOneThread() {
+  auto list = Build<control_block::NonAtomicCount>(kLength);
+  CHECK(list.size() == kLength);
+  auto snapshot = list;
+  for (size_t i = 0; i < kLength / 2; ++i) {
+    list.pop_front();
+  }
+  CHECK(list.size() == kLength / 2);
+  CHECK(snapshot.size() == kLength);
+}
+
+void DropTwoSnapshotsAtOnce() {
+  for (int round = 0; round < 20; ++round) {
+    auto first = Build<control_block::AtomicCount>(kLength);
+    auto second = first;
+    // The snapshots share every node but the first few of `second`.
+    second.push_front(0);
+    std::thread other([&] { first = {}; });
+    second = {};
+    other.join();
+    CHECK(first.empty() && second.empty());
+  }
+}
+
+int main() {
+  DropOnOneThread();
+  DropTwoSnapshotsAtOnce();
+  return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file pointer_cast_test.cpp
+ * @author SofiHaku
+ *
+ * Aliasing constructors, pointer casts and EnableSharedFromThis share the
+ * block of the pointer they start from: the count is one for all of them,
+ * nothing is allocated, rvalue casts hand the reference over, and
+ * shared_from_this() finds the block whichever way the object was made.
+ */
+
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "Allocators/tracking_allocator.hpp"
+#include "SmartPointers/sm_pointers.hpp"
+#include "test_common.hpp"
+
+struct Base {
+  virtual ~Base() = default;
+  int base = 1;
+};
+
+struct Derived : Base {
+  int derived = 2;
+};
+
+struct Other : Base {};
+
+struct Pair {
+  int first = 3;
+  int second = 4;
+};
+
+struct Self : EnableSharedFromThis<Self> {
+  int value = 5;
+};
+
+void Aliasing(AllocationStats& stats, const TrackingAllocator<Pair>& alloc) {
+  SharedPtr<Pair> owner = AllocateShared<Pair, control_block::DefaultCount>(
+      alloc);
+  size_t allocations = stats.allocations();
+
+  SharedPtr<int> second(owner, &owner->second);
+  CHECK(*second == 4);
+  CHECK(owner.use_count() == 2);
+  CHECK(second.use_count() == 2);
+
+  SharedPtr<int> moved(std::move(second), &owner->first);
+  CHECK(second.get() == nullptr);
+  CHECK(*moved == 3);
+  CHECK(owner.use_count() == 2);
+
+  // The alias keeps the whole object alive.
+  owner.reset();
+  CHECK(moved.use_count() == 1);
+  CHECK(*moved == 3);
+  CHECK(stats.allocations() == allocations);
+}
+
+void Casts(AllocationStats& stats, const TrackingAllocator<Derived>& alloc) {
+  SharedPtr<Derived> derived =
+      AllocateShared<Derived, control_block::DefaultCount>(alloc);
+  size_t allocations = stats.allocations();
+
+  SharedPtr<Base> base = StaticPointerCast<Base>(derived);
+  CHECK(base.get() == derived.get());
+  CHECK(derived.use_count() == 2);
+
+  SharedPtr<Derived> down = DynamicPointerCast<Derived>(base);
+  CHECK(down.get() == derived.get());
+  CHECK(derived.use_count() == 3);
+
+  SharedPtr<Other> wrong = DynamicPointerCast<Other>(base);
+  CHECK(wrong.get() == nullptr);
+  CHECK(wrong.use_count() == 0);
+  CHECK(derived.use_count() == 3);
+
+  SharedPtr<const Derived> constant = ConstPointerCast<const Derived>(down);
+  CHECK(derived.use_count() == 4);
+  SharedPtr<Derived> mutable_again = ConstPointerCast<Derived>(constant);
+  CHECK(derived.use_count() == 5);
+
+  // Rvalue casts take the reference of their source.
+  SharedPtr<Derived> from_static = StaticPointerCast<Derived>(std::move(base));
+  CHECK(base.get() == nullptr);
+  CHECK(derived.use_count() == 5);
+
+  SharedPtr<Base> up = from_static;
+  SharedPtr<Derived> from_dynamic = DynamicPointerCast<Derived>(std::move(up));
+  CHECK(up.get() == nullptr);
+  CHECK(from_dynamic.get() == derived.get());
+  CHECK(derived.use_count() == 6);
+
+  // A failed rvalue cast leaves its source as it was.
+  SharedPtr<Base> kept = derived;
+  SharedPtr<Other> failed = DynamicPointerCast<Other>(std::move(kept));
+  CHECK(failed.get() == nullptr);
+  CHECK(kept.get() == derived.get());
+  CHECK(derived.use_count() == 7);
+
+  SharedPtr<Derived> from_const = ConstPointerCast<Derived>(std::move(constant));
+  CHECK(constant.get() == nullptr);
+  CHECK(derived.use_count() == 7);
+
+  CHECK(stats.allocations() == allocations);
+}
+
+void CheckSelf(SharedPtr<Self>& self) {
+  CHECK(self.use_count() == 1);
+  SharedPtr<Self> again = self->shared_from_this();
+  CHECK(again.get() == self.get());
+  CHECK(self.use_count() == 2);
+  const Self& constant = *self;
+  SharedPtr<const Self> const_again = constant.shared_from_this();
+  CHECK(self.use_count() == 3);
+  CHECK(!self->weak_from_this().expired());
+}
+
+void SharedFromThis(AllocationStats& stats,
+                    const TrackingAllocator<Self>& alloc) {
+  SharedPtr<Self> made = MakeShared<Self>();
+  CheckSelf(made);
+
+  SharedPtr<Self> raw(new Self());
+  CheckSelf(raw);
+
+  SharedPtr<Self> allocated =
+      AllocateShared<Self, control_block::DefaultCount>(alloc);
+  size_t allocations = stats.allocations();
+  CheckSelf(allocated);
+  CHECK(stats.allocations() == allocations);
+
+  WeakPtr<Self> weak = allocated->weak_from_this();
+  allocated.reset();
+  CHECK(weak.expired());
+
+  // Not owned by any SharedPtr.
+  Self unowned;
+  bool thrown = false;
+  try {
+    unowned.shared_from_this();
+  } catch (const std::bad_weak_ptr&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  CHECK(unowned.weak_from_this().expired());
+}
+
+int main() {
+  SharedPtr<AllocationStats> stats = MakeShared<AllocationStats>();
+  Aliasing(*stats, TrackingAllocator<Pair>(stats));
+  Casts(*stats, TrackingAllocator<Derived>(stats));
+  SharedFromThis(*stats, TrackingAllocator<Self>(stats));
+  CHECK(stats->allocations() == stats->deallocations());
+  CHECK(stats->bytes_in_use() == 0);
+  return 0;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file pool_allocator_test.cpp
+ * @author SofiHaku
+ *
+ * Edge sizes of PoolAllocator: empty requests come from the smallest class
+ * as distinct blocks, and counts whose size overflows throw.
+ */
+
+#include <new>
+#include <set>
+
+#include "SmartPointers/pool_allocator.hpp"
+#include "test_common.hpp"
+
+struct Wide {
+  char bytes[64];
+};
+
+int main() {
+  CHECK(pool::ClassOf(0) == 0);
+  CHECK(pool::ClassOf(1) == 0);
+  CHECK(pool::ClassOf(pool::kMaxBlockSize) == pool::kClasses - 1);
+
+  pool::PoolAllocator<int> ints;
+  std::set<int*> empty;
+  for (int i = 0; i < 100; ++i) {
+    empty.insert(ints.allocate(0));
+  }
+  CHECK(empty.size() == 100);
+  for (int* ptr : empty) {
+    ints.deallocate(ptr, 0);
+  }
+
+  pool::PoolAllocator<Wide> wide;
+  bool thrown = false;
+  try {
+    wide.allocate(wide.max_size() + 1);
+  } catch (const std::bad_array_new_length&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  Wide* pooled = wide.allocate(pool::kMaxBlockSize / sizeof(Wide));
+  Wide* large = wide.allocate(pool::kMaxBlockSize / sizeof(Wide) + 1);
+  wide.deallocate(pooled, pool::kMaxBlockSize / sizeof(Wide));
+  wide.deallocate(large, pool::kMaxBlockSize / sizeof(Wide) + 1);
+  return 0;
+}
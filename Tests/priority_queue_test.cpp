@@ -0,0 +1,96 @@
+/**
+ * @file priority_queue_test.cpp
+ * @author SofiHaku
+ *
+ * PriorityQueue against a map under a random mix of push, push_bulk,
+ * pop and decrease_key: the top must be the largest live value, and every
+ * live handle must still name its own value after any number of sifts.
+ * Handles of popped elements must stay dead once their records are reused
+ * by later pushes.
+ */
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "Deque/priority_queue.hpp"
+#include "test_common.hpp"
+
+template <size_t D>
+void CheckAgainstMap(unsigned seed) {
+  using Queue = PriorityQueue<uint64_t, std::less<uint64_t>, D>;
+  using Handle = typename Queue::Handle;
+  Queue queue;
+  std::map<uint64_t, Handle> live;  // Handle by value.
+  std::vector<Handle> dead;
+  std::mt19937_64 random(seed);
+  // Values are unique, so the popped one tells which handle died: a random
+  // part above a counter, which raising in decrease_key does not touch.
+  uint64_t counter = 0;
+  auto next_value = [&] { return (random() % 1000000) << 32 | counter++; };
+
+  for (size_t step = 0; step < 20000; ++step) {
+    size_t op = random() % 8;
+    if (op < 3) {
+      uint64_t value = next_value();
+      live[value] = queue.push(value);
+    } else if (op == 3) {
+      std::vector<uint64_t> batch(random() % 64);
+      for (uint64_t& value : batch) {
+        value = next_value();
+      }
+      std::vector<Handle> handles;
+      queue.push_bulk(batch.begin(), batch.end(), std::back_inserter(handles));
+      CHECK(handles.size() == batch.size());
+      for (size_t i = 0; i < batch.size(); ++i) {
+        live[batch[i]] = handles[i];
+      }
+    } else if (op < 7 && !queue.empty()) {
+      auto top = std::prev(live.end());
+      CHECK(queue.top() == top->first);
+      dead.push_back(top->second);
+      live.erase(top);
+      queue.pop();
+    } else if (!live.empty()) {
+      auto it = live.lower_bound(next_value());
+      it = it == live.end() ? live.begin() : it;
+      uint64_t raised = it->first + ((random() % 1000) << 32);
+      Handle handle = it->second;
+      live.erase(it);
+      live[raised] = handle;
+      queue.decrease_key(handle, raised);
+    }
+
+    CHECK(queue.size() == live.size());
+    if (step % 500 == 0) {
+      for (const auto& [value, handle] : live) {
+        CHECK(queue.contains(handle));
+        CHECK(queue.value(handle) == value);
+      }
+      for (const Handle& handle : dead) {
+        CHECK(!queue.contains(handle));
+      }
+    }
+  }
+}
+
+int main() {
+  for (unsigned seed = 0; seed < 4; ++seed) {
+    CheckAgainstMap<2>(seed);
+    CheckAgainstMap<4>(seed);
+  }
+
+  // A record freed by pop and taken by the next push: the old handle must
+  // not see the new element.
+  PriorityQueue<int> queue;
+  auto first = queue.push(1);
+  queue.pop();
+  auto second = queue.push(2);
+  CHECK(second.record == first.record);
+  CHECK(second != first);
+  CHECK(!queue.contains(first));
+  CHECK(queue.contains(second));
+  return 0;
+}
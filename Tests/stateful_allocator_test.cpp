@@ -0,0 +1,242 @@
+/**
+ * @file stateful_allocator_test.cpp
+ * @author SofiHaku
+ *
+ * Deque and List with stateful allocators: the allocator-extended copy and
+ * move constructors and assignment take the memory of `other` only when
+ * their allocator can free it and move the elements one by one otherwise,
+ * non-propagating allocators (ArenaAllocator) stay with their container,
+ * and every sized constructor unwinds an element that throws. Each set of
+ * stats ends with nothing in use.
+ * Meant to be run with -DTEST_SANITIZER=address as well.
+ */
+
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+
+#include "Allocators/monotonic_arena.hpp"
+#include "Allocators/tracking_allocator.hpp"
+#include "Deque/deque.hpp"
+#include "List/list.hpp"
+#include "test_common.hpp"
+
+long live = 0;
+long budget = -1;  // Constructions left before one throws; -1 is no limit.
+
+struct Item {
+  size_t value;
+
+  static void spend() {
+    if (budget == 0) {
+      throw 1;
+    }
+    if (budget > 0) {
+      --budget;
+    }
+    ++live;
+  }
+
+  Item() : value(0) { spend(); }
+  Item(size_t value) : value(value) { spend(); }
+  Item(const Item& other) : value(other.value) { spend(); }
+  Item(Item&& other) : value(other.value) {
+    spend();
+    other.value = 0;
+  }
+  Item& operator=(const Item&) = default;
+  Item& operator=(Item&&) = default;
+  ~Item() { --live; }
+};
+
+using Tracked = TrackingAllocator<Item>;
+
+template <typename Container>
+void Fill(Container& container, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    container.push_back(Item(i));
+  }
+}
+
+template <typename Container>
+bool Holds(Container& container, size_t count) {
+  if (container.size() != count) {
+    return false;
+  }
+  size_t i = 0;
+  for (auto it = container.begin(); it != container.end(); ++it, ++i) {
+    if ((*it).value != i) {
+      return false;
+    }
+  }
+  return i == count;
+}
+
+template <typename Container>
+const Item* First(Container& container) {
+  return &*container.begin();
+}
+
+// Moves between allocators that compare equal take the memory; between
+// unequal ones the elements are moved into memory of the new allocator.
+template <typename Container>
+void MoveWithAllocator() {
+  SharedPtr<AllocationStats> first = MakeShared<AllocationStats>();
+  SharedPtr<AllocationStats> second = MakeShared<AllocationStats>();
+  {
+    Container source{Tracked(first)};
+    Fill(source, 1000);
+    const Item* address = First(source);
+    size_t allocations = first->allocations();
+
+    Container same(std::move(source), Tracked(first));
+    CHECK(Holds(same, 1000));
+    CHECK(First(same) == address);
+    CHECK(first->allocations() == allocations);
+
+    Container other(std::move(same), Tracked(second));
+    CHECK(Holds(other, 1000));
+    CHECK(First(other) != address);
+    CHECK(second->allocations() > 0);
+
+    Container copy(other, Tracked(first));
+    CHECK(Holds(copy, 1000));
+    CHECK(Holds(other, 1000));
+
+    // TrackingAllocator propagates: the stats follow the memory.
+    Container target{Tracked(second)};
+    Fill(target, 10);
+    const Item* copy_address = First(copy);
+    target = std::move(copy);
+    CHECK(Holds(target, 1000));
+    CHECK(First(target) == copy_address);
+    CHECK(target.get_allocator().stats().get() == first.get());
+
+    target = other;
+    CHECK(Holds(target, 1000));
+    CHECK(target.get_allocator().stats().get() == second.get());
+  }
+  CHECK(live == 0);
+  CHECK(first->bytes_in_use() == 0);
+  CHECK(second->bytes_in_use() == 0);
+  CHECK(first->allocations() == first->deallocations());
+  CHECK(second->allocations() == second->deallocations());
+}
+
+// ArenaAllocator does not propagate: assignment between containers of
+// different arenas moves or copies the elements into the target's arena.
+template <typename Container>
+void AssignBetweenArenas() {
+  MonotonicArena first_arena;
+  MonotonicArena second_arena;
+  using Arena = ArenaAllocator<Item>;
+  {
+    Container source{Arena(first_arena)};
+    Fill(source, 500);
+    Container target{Arena(second_arena)};
+    Fill(target, 5);
+    size_t first_used = first_arena.bytes_used();
+    size_t second_used = second_arena.bytes_used();
+
+    target = std::move(source);
+    CHECK(Holds(target, 500));
+    CHECK(target.get_allocator() == Arena(second_arena));
+    CHECK(first_arena.bytes_used() == first_used);
+    CHECK(second_arena.bytes_used() > second_used);
+
+    Container same{Arena(second_arena)};
+    second_used = second_arena.bytes_used();
+    const Item* address = First(target);
+    same = std::move(target);
+    CHECK(Holds(same, 500));
+    CHECK(First(same) == address);
+    CHECK(second_arena.bytes_used() == second_used);
+
+    Container copy{Arena(first_arena)};
+    copy = same;
+    CHECK(Holds(copy, 500));
+    CHECK(copy.get_allocator() == Arena(first_arena));
+    CHECK(first_arena.bytes_used() > first_used);
+  }
+  CHECK(live == 0);
+}
+
+// Builds with `build` while a throw comes after every possible number of
+// constructions, and expects each attempt to leave no element and no byte
+// of `stats` behind.
+template <typename Build>
+void ThrowAtEveryStep(const SharedPtr<AllocationStats>& stats, long steps,
+                      Build build) {
+  long live_before = live;
+  size_t bytes_before = stats->bytes_in_use();
+  for (long step = 0; step <= steps; step += 1 + step / 8) {
+    budget = step;
+    try {
+      build();
+    } catch (int) {
+    }
+    budget = -1;
+    CHECK(live == live_before);
+    CHECK(stats->bytes_in_use() == bytes_before);
+  }
+}
+
+void DequeConstructorsUnwind() {
+  using Container = Deque<Item, Tracked>;
+  SharedPtr<AllocationStats> stats = MakeShared<AllocationStats>();
+  Tracked alloc(stats);
+  ThrowAtEveryStep(stats, 300, [&] {
+    Container deque(300, alloc);
+    CHECK(deque.size() == 300);
+  });
+  ThrowAtEveryStep(stats, 301, [&] {
+    Container deque(300, Item(7), alloc);
+    CHECK(deque.size() == 300);
+  });
+  ThrowAtEveryStep(stats, 4, [&] {
+    Container deque({Item(0), Item(1)}, alloc);
+    CHECK(Holds(deque, 2));
+  });
+
+  Container source{alloc};
+  Fill(source, 300);
+  ThrowAtEveryStep(stats, 300, [&] {
+    Container copy(source, alloc);
+    CHECK(Holds(copy, 300));
+  });
+  // Into memory of other stats, one element at a time; wherever the move
+  // stops, source keeps its 300 elements.
+  SharedPtr<AllocationStats> other_stats = MakeShared<AllocationStats>();
+  Tracked other(other_stats);
+  ThrowAtEveryStep(other_stats, 299, [&] {
+    Container moved(std::move(source), other);
+    CHECK(moved.size() == 300);
+  });
+  CHECK(source.size() == 300);
+  CHECK(other_stats->bytes_in_use() == 0);
+}
+
+void ListCopyUnwinds() {
+  using Container = List<Item, Tracked>;
+  SharedPtr<AllocationStats> stats = MakeShared<AllocationStats>();
+  Tracked alloc(stats);
+  SharedPtr<AllocationStats> source_stats = MakeShared<AllocationStats>();
+  Container source{Tracked(source_stats)};
+  Fill(source, 100);
+  ThrowAtEveryStep(stats, 100, [&] {
+    Container copy(source, alloc);
+    CHECK(Holds(copy, 100));
+  });
+  CHECK(Holds(source, 100));
+}
+
+int main() {
+  MoveWithAllocator<Deque<Item, Tracked>>();
+  MoveWithAllocator<List<Item, Tracked>>();
+  AssignBetweenArenas<Deque<Item, ArenaAllocator<Item>>>();
+  AssignBetweenArenas<List<Item, ArenaAllocator<Item>>>();
+  DequeConstructorsUnwind();
+  ListCopyUnwinds();
+  CHECK(live == 0);
+  return 0;
+}
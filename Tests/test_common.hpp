@@ -0,0 +1,19 @@
+/**
+ * @file test_common.hpp
+ * @author SofiHaku
+ */
+
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+// Stops the test with the failed condition and where it is. Tests are plain
+// programs run by CTest; a non-zero exit code is a failure.
+#define CHECK(condition)                                               \
+  do {                                                                 \
+    if (!(condition)) {                                                \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,      \
+                   __LINE__, #condition);                              \
+      std::exit(1);                                                    \
+    }                                                                  \
+  } while (false)
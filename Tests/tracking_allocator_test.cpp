@@ -0,0 +1,94 @@
+/**
+ * @file tracking_allocator_test.cpp
+ * @author SofiHaku
+ *
+ * Allocations per operation through TrackingAllocator: List nodes, Deque
+ * buckets and AllocateShared blocks, each reached by rebinding, report to
+ * one AllocationStats, requests land in the histogram bucket of their size,
+ * and everything is given back once the containers and pointers are gone.
+ */
+
+#include "Allocators/tracking_allocator.hpp"
+#include "Deque/deque.hpp"
+#include "List/list.hpp"
+#include "test_common.hpp"
+
+// Bucket of the histogram that counts requests of `bytes`.
+size_t BucketOf(size_t bytes) {
+  size_t index = 0;
+  for (; bytes; bytes >>= 1) {
+    ++index;
+  }
+  return index;
+}
+
+void Histogram(const SharedPtr<AllocationStats>& stats) {
+  TrackingAllocator<char> alloc(stats);
+  size_t before = stats->histogram(BucketOf(100));
+  size_t allocations = stats->allocations();
+  char* bytes = alloc.allocate(100);
+  CHECK(stats->histogram(BucketOf(100)) == before + 1);
+  CHECK(BucketOf(100) == 7);  // 64..127 bytes.
+  CHECK(stats->allocations() == allocations + 1);
+  CHECK(stats->bytes_in_use() >= 100);
+  alloc.deallocate(bytes, 100);
+}
+
+void ListNodes(const SharedPtr<AllocationStats>& stats) {
+  List<int, TrackingAllocator<int>> list{TrackingAllocator<int>(stats)};
+  size_t allocations = stats->allocations();
+  // The first element brings the sentinel with it, every further one a
+  // node of its own.
+  list.push_back(0);
+  CHECK(stats->allocations() == allocations + 2);
+  for (int i = 1; i <= 100; ++i) {
+    list.push_back(i);
+    list.push_front(-i);
+  }
+  CHECK(stats->allocations() == allocations + 2 + 200);
+  for (int i = 0; i < 50; ++i) {
+    list.pop_back();
+    list.pop_front();
+  }
+  CHECK(stats->deallocations() >= 100);
+}
+
+void DequeBuckets(const SharedPtr<AllocationStats>& stats) {
+  Deque<int, TrackingAllocator<int>> deque{TrackingAllocator<int>(stats)};
+  size_t allocations = stats->allocations();
+  const size_t kPushes = 10000;
+  for (size_t i = 0; i < kPushes; ++i) {
+    deque.push_back(static_cast<int>(i));
+  }
+  // Buckets of 512 bytes hold 128 ints; the vector of bucket pointers is
+  // not allocated through the allocator.
+  size_t buckets = stats->allocations() - allocations;
+  CHECK(buckets >= kPushes / 128);
+  CHECK(buckets <= kPushes / 128 + 4);
+  CHECK(stats->histogram(BucketOf(512)) >= buckets);
+}
+
+void SharedBlocks(const SharedPtr<AllocationStats>& stats) {
+  TrackingAllocator<int> alloc(stats);
+  size_t allocations = stats->allocations();
+  SharedPtr<int> one = AllocateShared<int, control_block::DefaultCount>(alloc);
+  CHECK(stats->allocations() == allocations + 1);
+  SharedPtr<int[]> array =
+      AllocateShared<int[], control_block::DefaultCount>(alloc, 64);
+  CHECK(stats->allocations() == allocations + 2);
+  SharedPtr<int> copy = one;
+  CHECK(stats->allocations() == allocations + 2);
+}
+
+int main() {
+  SharedPtr<AllocationStats> stats = MakeShared<AllocationStats>();
+  Histogram(stats);
+  ListNodes(stats);
+  DequeBuckets(stats);
+  SharedBlocks(stats);
+  CHECK(stats->allocations() > 0);
+  CHECK(stats->allocations() == stats->deallocations());
+  CHECK(stats->bytes_in_use() == 0);
+  CHECK(stats->peak_bytes() > 0);
+  return 0;
+}
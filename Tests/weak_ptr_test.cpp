@@ -0,0 +1,131 @@
+/**
+ * @file weak_ptr_test.cpp
+ * @author SofiHaku
+ *
+ * WeakPtr promotion takes a reference on the existing block and allocates
+ * nothing, and fails once the last owner is gone. WeakValueCache hands
+ * every thread racing on a key the same object, and find(), purge() and
+ * size() reclaim the entries of dead objects.
+ * Meant to be run with -DTEST_SANITIZER=thread and address as well.
+ */
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "Allocators/tracking_allocator.hpp"
+#include "SmartPointers/weak_value_cache.hpp"
+#include "test_common.hpp"
+
+std::atomic<long> live{0};
+std::atomic<long> created{0};
+
+struct Value {
+  size_t key;
+
+  explicit Value(size_t key) : key(key) {
+    ++live;
+    ++created;
+  }
+  ~Value() { --live; }
+};
+
+void Lock() {
+  SharedPtr<AllocationStats> stats = MakeShared<AllocationStats>();
+  TrackingAllocator<Value> alloc(stats);
+  SharedPtr<Value> owner =
+      AllocateShared<Value, control_block::DefaultCount>(alloc, 7);
+  WeakPtr<Value> weak(owner);
+  size_t allocations = stats->allocations();
+
+  {
+    SharedPtr<Value> locked = weak.lock();
+    CHECK(locked.get() == owner.get());
+    CHECK(owner.use_count() == 2);
+    SharedPtr<Value> constructed(weak);
+    CHECK(constructed.get() == owner.get());
+    CHECK(owner.use_count() == 3);
+  }
+  CHECK(owner.use_count() == 1);
+  for (size_t i = 0; i < 1000; ++i) {
+    SharedPtr<Value> locked = weak.lock();
+  }
+  CHECK(stats->allocations() == allocations);
+
+  owner.reset();
+  CHECK(live.load() == 0);
+  CHECK(weak.expired());
+  CHECK(weak.lock().get() == nullptr);
+  bool thrown = false;
+  try {
+    SharedPtr<Value> constructed(weak);
+  } catch (const std::bad_weak_ptr&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  CHECK(weak.use_count() == 0);
+
+  // The block itself goes with the last weak reference.
+  weak.reset();
+  CHECK(stats->bytes_in_use() == 0);
+}
+
+void CacheConvergence() {
+  const size_t kKeys = 1000;
+  const size_t kThreads = 4;
+  WeakValueCache<size_t, Value> cache;
+  // Every thread keeps what it got, so the first object published for a
+  // key stays alive and every later lookup must return it.
+  std::vector<std::vector<SharedPtr<Value>>> got(
+      kThreads, std::vector<SharedPtr<Value>>(kKeys));
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t i = 0; i < kKeys; ++i) {
+        // Pairs of threads walk the keys in the same order, so they race.
+        size_t key = t % 2 ? kKeys - 1 - i : i;
+        got[t][key] = cache.get_or_create(
+            key, [key] { return MakeShared<Value>(key); });
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t key = 0; key < kKeys; ++key) {
+    CHECK(got[0][key]->key == key);
+    for (size_t t = 1; t < kThreads; ++t) {
+      CHECK(got[t][key].get() == got[0][key].get());
+    }
+  }
+  // Objects that lost a race are gone; one per key is left.
+  CHECK(live.load() == static_cast<long>(kKeys));
+  CHECK(created.load() >= static_cast<long>(kKeys));
+  CHECK(cache.size() == kKeys);
+  CHECK(cache.purge() == 0);
+
+  got.clear();
+  CHECK(live.load() == 0);
+  // Dead entries stay until something reclaims them.
+  CHECK(cache.size() == kKeys);
+  CHECK(cache.find(0).get() == nullptr);
+  CHECK(cache.size() == kKeys - 1);
+  CHECK(cache.purge() == kKeys - 1);
+  CHECK(cache.size() == 0);
+
+  SharedPtr<Value> value =
+      cache.get_or_create(1, [] { return MakeShared<Value>(1); });
+  CHECK(cache.find(1).get() == value.get());
+  CHECK(cache.insert(1, MakeShared<Value>(2)).get() == value.get());
+  cache.erase(1);
+  CHECK(cache.find(1).get() == nullptr);
+}
+
+int main() {
+  Lock();
+  CacheConvergence();
+  CHECK(live.load() == 0);
+  return 0;
+}
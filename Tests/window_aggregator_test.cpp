@@ -0,0 +1,131 @@
+/**
+ * @file window_aggregator_test.cpp
+ * @author SofiHaku
+ *
+ * WindowAggregator against folding the window from scratch, after every
+ * step of a random mix of push_back, pop_front(), pop_front(count) and
+ * pop_front_while, for Sum, Max and string concatenation; concatenation
+ * is not commutative, so combine must see the events in arrival order.
+ * Also a Deque used as a FIFO queue must reach a fixed number of buckets
+ * and stop allocating, however long it runs.
+ */
+
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+
+#include "Allocators/tracking_allocator.hpp"
+#include "Deque/window_aggregator.hpp"
+#include "test_common.hpp"
+
+// Each event becomes one letter; the aggregate spells the window.
+struct Concat {
+  using Aggregate = std::string;
+  Aggregate identity() const { return std::string(); }
+  Aggregate lift(uint64_t value) const {
+    return std::string(1, static_cast<char>('a' + value % 26));
+  }
+  Aggregate combine(const Aggregate& left, const Aggregate& right) const {
+    return left + right;
+  }
+};
+
+// Adds one event to a fold in progress: through the monoid, or by
+// appending the letter, which keeps folding a long window linear.
+template <typename Monoid>
+void Accumulate(const Monoid& monoid, typename Monoid::Aggregate& aggregate,
+                uint64_t event) {
+  aggregate = monoid.combine(aggregate, monoid.lift(event));
+}
+void Accumulate(const Concat& monoid, std::string& aggregate,
+                uint64_t event) {
+  aggregate += monoid.lift(event);
+}
+
+template <typename Monoid>
+typename Monoid::Aggregate Fold(const std::deque<uint64_t>& events) {
+  Monoid monoid;
+  typename Monoid::Aggregate aggregate = monoid.identity();
+  for (uint64_t event : events) {
+    Accumulate(monoid, aggregate, event);
+  }
+  return aggregate;
+}
+
+template <typename Monoid>
+void CheckAgainstFold(unsigned seed) {
+  WindowAggregator<uint64_t, Monoid> aggregator;
+  std::deque<uint64_t> events;
+  std::mt19937_64 random(seed);
+  CHECK(aggregator.query() == Monoid().identity());
+  for (size_t step = 0; step < 20000; ++step) {
+    // Phases that favour arrivals and expiries in turn, so the window
+    // grows to hundreds of events and drains again.
+    bool grow = (step / 2000) % 2 == 0;
+    size_t op = random() % 10;
+    if (op < (grow ? 7u : 3u) || events.empty()) {
+      uint64_t event = random() % 1000;
+      aggregator.push_back(event);
+      events.push_back(event);
+    } else if (op < 8) {
+      aggregator.pop_front();
+      events.pop_front();
+    } else if (op < 9) {
+      size_t count = random() % 8;
+      count = count < events.size() ? count : events.size();
+      aggregator.pop_front(count);
+      events.erase(events.begin(), events.begin() + count);
+    } else {
+      uint64_t limit = random() % 200;
+      size_t expected = 0;
+      while (expected < events.size() && events[expected] < limit) {
+        ++expected;
+      }
+      size_t count = aggregator.pop_front_while(
+          [limit](uint64_t event) { return event < limit; });
+      CHECK(count == expected);
+      events.erase(events.begin(), events.begin() + count);
+    }
+    CHECK(aggregator.size() == events.size());
+    CHECK(aggregator.query() == Fold<Monoid>(events));
+    if (!events.empty()) {
+      CHECK(aggregator.front() == events.front());
+    }
+  }
+}
+
+// A queue of steady length: once the buckets it needs exist, the spare
+// ones left behind by pop_front are rotated round and reused.
+void FifoStopsAllocating() {
+  SharedPtr<AllocationStats> stats = MakeShared<AllocationStats>();
+  Deque<uint64_t, TrackingAllocator<uint64_t>> queue{
+      TrackingAllocator<uint64_t>(stats)};
+  const size_t kLength = 1000;
+  for (size_t i = 0; i < kLength; ++i) {
+    queue.push_back(i);
+  }
+  for (size_t i = 0; i < 100000; ++i) {
+    queue.push_back(i);
+    queue.pop_front();
+  }
+  size_t allocations = stats->allocations();
+  size_t peak = stats->peak_bytes();
+  for (size_t i = 0; i < 1000000; ++i) {
+    queue.push_back(i);
+    queue.pop_front();
+  }
+  CHECK(queue.size() == kLength);
+  CHECK(stats->allocations() == allocations);
+  CHECK(stats->peak_bytes() == peak);
+}
+
+int main() {
+  for (unsigned seed = 0; seed < 3; ++seed) {
+    CheckAgainstFold<window::Sum<uint64_t>>(seed);
+    CheckAgainstFold<window::Max<uint64_t>>(seed);
+    CheckAgainstFold<Concat>(seed);
+  }
+  FifoStopsAllocating();
+  return 0;
+}